@@ -10,8 +10,14 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor (AudioPluginAud
     : AudioProcessorEditor (&p), processorRef (p), mParameters (vts)
 {
     juce::ignoreUnused (processorRef);
+    // the analysis runs while an editor is open
+    processorRef.addConsumer();
 
     addAndMakeVisible(mMagnitudesComponent);
+    addAndMakeVisible(mChromaFeatureComponent);
+    addAndMakeVisible(mOctaveMagnitudesComponent);
+    addAndMakeVisible(mPitchReadoutComponent);
+    addAndMakeVisible(mHarmonyReadoutComponent);
 
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
@@ -26,14 +32,18 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor (AudioPluginAud
     const float tuningParameter = mParameters.getParameterAsValue("tuning").getValue();
     const float rangeMinParameter = mParameters.getParameterAsValue("rangeMin").getValue();
     const float rangeMaxParameter = mParameters.getParameterAsValue("rangeMax").getValue();
-    const float smoothingUpParameter = mParameters.getParameterAsValue("smoothingUp").getValue();
-    const float smoothingDownParameter = mParameters.getParameterAsValue("smoothingDown").getValue();
+    const float attackParameter = mParameters.getParameterAsValue("attackMs").getValue();
+    const float releaseParameter = mParameters.getParameterAsValue("releaseMs").getValue();
+    const bool timeAlignedParameter = mParameters.getParameterAsValue("timeAligned").getValue();
 
     // labels
     addAndMakeVisible(mChannelLabel);
     addAndMakeVisible(mRangeLabel);
     addAndMakeVisible(mTuningLabel);
     addAndMakeVisible(mSmoothingLabel);
+    addAndMakeVisible(mHistoryLabel);
+    addAndMakeVisible(mZoomLabel);
+    addAndMakeVisible(mSnapshotLabel);
     addAndMakeVisible(mHeadingLabel);
     addAndMakeVisible(mVersionLabel);
     addAndMakeVisible(mWebsiteLabel);
@@ -42,6 +52,9 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor (AudioPluginAud
     mRangeLabel.setText("Range: ", juce::dontSendNotification);
     mTuningLabel.setText("Tuning: ", juce::dontSendNotification);
     mSmoothingLabel.setText("Smoothing: ", juce::dontSendNotification);
+    mHistoryLabel.setText("History: ", juce::dontSendNotification);
+    mZoomLabel.setText("Zoom: ", juce::dontSendNotification);
+    mSnapshotLabel.setText("Compare: ", juce::dontSendNotification);
     mHeadingLabel.setText("CqtAnalyzer", juce::dontSendNotification);
     mVersionLabel.setText("Version 0.2.0", juce::dontSendNotification);
     mWebsiteLabel.setText("www.ChromaDSP.com", juce::dontSendNotification);
@@ -50,6 +63,9 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor (AudioPluginAud
     mRangeLabel.setColour (juce::Label::textColourId, juce::Colours::white);
     mTuningLabel.setColour (juce::Label::textColourId, juce::Colours::white);
     mSmoothingLabel.setColour (juce::Label::textColourId, juce::Colours::white);
+    mHistoryLabel.setColour (juce::Label::textColourId, juce::Colours::white);
+    mZoomLabel.setColour (juce::Label::textColourId, juce::Colours::white);
+    mSnapshotLabel.setColour (juce::Label::textColourId, juce::Colours::white);
     mHeadingLabel.setColour (juce::Label::textColourId, juce::Colours::white);
     mVersionLabel.setColour (juce::Label::textColourId, juce::Colours::white);
     mWebsiteLabel.setColour (juce::Label::textColourId, juce::Colours::white);
@@ -72,9 +88,20 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor (AudioPluginAud
     mSideChannelButton.onClick = [this] {channelButtonClicked(3);};
     channelButtonClicked(channelParameter);
 
+    addAndMakeVisible(mAlignedButton);
+    mAlignedButton.setClickingTogglesState(true);
+    mAlignedButton.setColour (juce::TextButton::buttonColourId, juce::Colours::black);
+    mAlignedButton.setColour (juce::TextButton::buttonOnColourId, juce::Colour::fromHSV(0.57, 0.98, 0.725, 1.f));
+    mAlignedButton.setToggleState(timeAlignedParameter, juce::dontSendNotification);
+    mAlignedButton.onClick = [this] {alignedButtonClicked();};
+    alignedButtonClicked();
+
     addAndMakeVisible(mRangeSlider);
     addAndMakeVisible(mTuningSlider);
     addAndMakeVisible(mSmoothingSlider);
+    addAndMakeVisible(mHistorySlider);
+    addAndMakeVisible(mZoomSlider);
+    addAndMakeVisible(mSnapshotSlider);
 
     mRangeSlider.setSliderStyle(juce::Slider::SliderStyle::TwoValueHorizontal);
     mRangeSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::NoTextBox, true, 0, 0);
@@ -90,15 +117,36 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor (AudioPluginAud
     mTuningSlider.onValueChange = [this]{tuningSliderChanged();};
     tuningSliderChanged();
 
-    mSmoothingSlider.setRange(0., 1., 0.001);
-    mSmoothingSlider.setSkewFactor(4.);
+    mSmoothingSlider.setRange(0., 2000., 1.);
+    mSmoothingSlider.setSkewFactorFromMidPoint(150.);
     mSmoothingSlider.setSliderStyle(juce::Slider::SliderStyle::TwoValueHorizontal);
     mSmoothingSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::NoTextBox, true, 0, 0);
-    mSmoothingSlider.setMaxValue(smoothingDownParameter, juce::dontSendNotification);
-    mSmoothingSlider.setMinValue(smoothingUpParameter, juce::dontSendNotification);
+    mSmoothingSlider.setMaxValue(releaseParameter, juce::dontSendNotification);
+    mSmoothingSlider.setMinValue(attackParameter, juce::dontSendNotification);
     mSmoothingSlider.onValueChange = [this]{smoothingSliderChanged();};
     smoothingSliderChanged();
 
+    mHistorySlider.setRange(0., HistoryLengthHours * 3600., 0.05);
+    mHistorySlider.setSkewFactorFromMidPoint(60.);
+    mHistorySlider.setValue(0., juce::dontSendNotification);
+    mHistorySlider.setTextValueSuffix (" s ago");
+    mHistorySlider.onValueChange = [this]{historySliderChanged();};
+
+    mZoomSlider.setRange(0., static_cast<double>(HistoryLevels - 1), 1.);
+    mZoomSlider.setValue(0., juce::dontSendNotification);
+    mZoomSlider.onValueChange = [this]{historySliderChanged();};
+    historySliderChanged();
+
+    // 0 is live, n is the n-th beat or bar, the range grows with the captured snapshots
+    mSnapshotSlider.setSliderStyle(juce::Slider::SliderStyle::TwoValueHorizontal);
+    mSnapshotSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::NoTextBox, true, 0, 0);
+    updateSnapshotRange();
+    mSnapshotSlider.setMinValue(0., juce::dontSendNotification);
+    mSnapshotSlider.setMaxValue(0., juce::dontSendNotification);
+    mSnapshotSlider.onDragStart = [this]{updateSnapshotRange();};
+    mSnapshotSlider.onValueChange = [this]{snapshotSliderChanged();};
+    snapshotSliderChanged();
+
     mFrequencyTooltip.setMillisecondsBeforeTipAppears(100);
 
     // tooltips
@@ -117,7 +165,19 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor (AudioPluginAud
     mTuningSlider.setTooltip("Concert pitch tuning.");
 
     mSmoothingLabel.setTooltip("Smoothing of magnitudes (Attack and Release).");
-    mSmoothingSlider.setTooltip("Smoothing of magnitudes (Attack and Release).");
+
+    mHistoryLabel.setTooltip("Scrub back through the history, 0 s is live.");
+    mHistorySlider.setTooltip("Scrub back through the history, 0 s is live.");
+
+    mZoomLabel.setTooltip("Time span averaged per history frame.");
+    mZoomSlider.setTooltip("Time span averaged per history frame.");
+
+    mSnapshotLabel.setTooltip("Average spectrum of a beat or bar of the host timeline, the second one is drawn as lines.");
+
+    juce::String headingTooltip = "Analysis workers: " + processorRef.getWorkerPolicy() + ".";
+    if (processorRef.getSharedMemoryName().isNotEmpty())
+        headingTooltip = "Frames are published to shared memory " + processorRef.getSharedMemoryName() + ". " + headingTooltip;
+    mHeadingLabel.setTooltip(headingTooltip);
     
     
     
@@ -126,6 +186,7 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor (AudioPluginAud
 AudioPluginAudioProcessorEditor::~AudioPluginAudioProcessorEditor()
 {
     setLookAndFeel (nullptr);
+    processorRef.removeConsumer();
 }
 
 //==============================================================================
@@ -140,7 +201,7 @@ void AudioPluginAudioProcessorEditor::resized()
 {
     const float controlYFrac = 0.06f;
     const float headingYFrac = 0.08f;
-    const float magXFrac = 1.0f; 
+    const float magXFrac = 0.8f; 
     auto b = getLocalBounds().toFloat();
 
     auto controlRect = b.withTrimmedBottom((1.f - controlYFrac) * b.getHeight());
@@ -151,13 +212,14 @@ void AudioPluginAudioProcessorEditor::resized()
     spectrumRect = spectrumRect.withTrimmedRight((1.f - magXFrac) * b.getWidth());
 
     auto featureRect = b.withTrimmedLeft(magXFrac * b.getWidth());
-    featureRect.withTrimmedBottom(headingYFrac * b.getHeight());
+    featureRect = featureRect.withTrimmedTop(controlYFrac * b.getHeight());
+    featureRect = featureRect.withTrimmedBottom(headingYFrac * b.getHeight());
 
     auto headingRect = b.withTrimmedTop((1.f - headingYFrac) * b.getHeight());
 
     // controls
-    const float numControls = 4.f * 2.f; // 2.f to weight controls size
-    const float numLabels = 4.f;
+    const float numControls = 7.f * 2.f; // 2.f to weight controls size
+    const float numLabels = 7.f;
     const float controlWidth = 1.f / (numControls + numLabels);
     const float controlFill = 0.8f;
 
@@ -190,14 +252,48 @@ void AudioPluginAudioProcessorEditor::resized()
     controlRect.translate(controlRect.getWidth(), 0.f);
     mTuningSlider.setBounds(controlRect.withTrimmedRight(-controlRect.getWidth()).toNearestIntEdges());
 
+    controlRect.translate(controlRect.getWidth() * 2.f, 0.f);
+    mHistoryLabel.setBounds(controlRect.toNearestIntEdges());
+    controlRect.translate(controlRect.getWidth(), 0.f);
+    mHistorySlider.setBounds(controlRect.withTrimmedRight(-controlRect.getWidth()).toNearestIntEdges());
+
+    controlRect.translate(controlRect.getWidth() * 2.f, 0.f);
+    mZoomLabel.setBounds(controlRect.toNearestIntEdges());
+    controlRect.translate(controlRect.getWidth(), 0.f);
+    mZoomSlider.setBounds(controlRect.withTrimmedRight(-controlRect.getWidth()).toNearestIntEdges());
+
+    controlRect.translate(controlRect.getWidth() * 2.f, 0.f);
+    mSnapshotLabel.setBounds(controlRect.toNearestIntEdges());
+    controlRect.translate(controlRect.getWidth(), 0.f);
+    mSnapshotSlider.setBounds(controlRect.withTrimmedRight(-controlRect.getWidth()).toNearestIntEdges());
+
     // spectrum
     mMagnitudesComponent.setBounds(spectrumRect.toNearestIntEdges());
 
+    // features
+    const float midGap = 0.01f;
+    const float pitchYFrac = 0.14f;
+    mPitchReadoutComponent.setBounds(featureRect.withTrimmedBottom((1.f - pitchYFrac) * featureRect.getHeight()).toNearestIntEdges());
+    featureRect = featureRect.withTrimmedTop(pitchYFrac * featureRect.getHeight());
+    const float harmonyYFrac = 0.07f;
+    mHarmonyReadoutComponent.setBounds(featureRect.withTrimmedBottom((1.f - harmonyYFrac) * featureRect.getHeight()).toNearestIntEdges());
+    featureRect = featureRect.withTrimmedTop(harmonyYFrac * featureRect.getHeight());
+    auto chromaRect = featureRect.withTrimmedBottom(featureRect.getHeight() / 2.f + featureRect.getHeight() * midGap);
+    auto octaveRect = featureRect.withTrimmedTop(featureRect.getHeight() / 2.f + featureRect.getHeight() * midGap);
+    mChromaFeatureComponent.setBounds(chromaRect.toNearestIntEdges());
+    mOctaveMagnitudesComponent.setBounds(octaveRect.toNearestIntEdges());
+
     // heading
     const float sideGap = 0.02f;
     mHeadingLabel.setBounds(headingRect.toNearestIntEdges());
     mVersionLabel.setBounds(headingRect.withTrimmedLeft(sideGap * headingRect.getWidth()).toNearestIntEdges());
     mWebsiteLabel.setBounds(headingRect.withTrimmedRight(sideGap * headingRect.getWidth()).toNearestIntEdges());
+    const float alignedXFrac = 0.08f;
+    const float alignedYFill = 0.5f;
+    auto alignedRect = headingRect.withTrimmedLeft(0.62f * headingRect.getWidth());
+    alignedRect = alignedRect.withWidth(alignedXFrac * headingRect.getWidth());
+    alignedRect = alignedRect.withSizeKeepingCentre(alignedRect.getWidth(), alignedYFill * alignedRect.getHeight());
+    mAlignedButton.setBounds(alignedRect.toNearestIntEdges());
 
     mFrequencyTooltip.setBounds(b.toNearestIntEdges());
 
@@ -206,6 +302,9 @@ void AudioPluginAudioProcessorEditor::resized()
     mRangeLabel.setFont (juce::Font (LabelSize * labelScaling, juce::Font::bold));
     mTuningLabel.setFont (juce::Font (LabelSize * labelScaling, juce::Font::bold));
     mSmoothingLabel.setFont (juce::Font (LabelSize * labelScaling, juce::Font::bold));
+    mHistoryLabel.setFont (juce::Font (LabelSize * labelScaling, juce::Font::bold));
+    mZoomLabel.setFont (juce::Font (LabelSize * labelScaling, juce::Font::bold));
+    mSnapshotLabel.setFont (juce::Font (LabelSize * labelScaling, juce::Font::bold));
     mHeadingLabel.setFont (juce::Font (HeadingSize * labelScaling, juce::Font::bold));
     mVersionLabel.setFont (juce::Font (WebsiteSize * labelScaling, juce::Font::bold));
     mWebsiteLabel.setFont (juce::Font (WebsiteSize * labelScaling, juce::Font::bold));
@@ -267,8 +366,44 @@ void AudioPluginAudioProcessorEditor::tuningSliderChanged()
 
 void AudioPluginAudioProcessorEditor::smoothingSliderChanged()
 {
-    const auto smoothingUp = mSmoothingSlider.getMinValue();
-    const auto smoothingDown = mSmoothingSlider.getMaxValue();
-    mMagnitudesComponent.setSmoothing(smoothingUp, smoothingDown);
-    processorRef.setSmoothing(smoothingUp, smoothingDown);
+    const auto attackMs = mSmoothingSlider.getMinValue();
+    const auto releaseMs = mSmoothingSlider.getMaxValue();
+    processorRef.setBallistics(attackMs, releaseMs);
+    mSmoothingSlider.setTooltip("Smoothing of magnitudes (Attack " + juce::String(juce::roundToInt(attackMs))
+        + " ms, Release " + juce::String(juce::roundToInt(releaseMs)) + " ms).");
+}
+
+void AudioPluginAudioProcessorEditor::historySliderChanged()
+{
+    const int level = static_cast<int>(mZoomSlider.getValue());
+    const double secondsAgo = mHistorySlider.getValue();
+    mMagnitudesComponent.setHistoryView(secondsAgo, level);
+}
+
+void AudioPluginAudioProcessorEditor::alignedButtonClicked()
+{
+    const bool timeAligned = mAlignedButton.getToggleState();
+    processorRef.setTimeAligned(timeAligned);
+    mAlignedButton.setTooltip("Show all octaves at the same instant, centred on their windows. Adds "
+        + juce::String(juce::roundToInt(processorRef.getAlignedLatencyMs())) + " ms of latency.");
+}
+
+void AudioPluginAudioProcessorEditor::updateSnapshotRange()
+{
+    const double lastSnapshot = static_cast<double>(processorRef.getLastSnapshotIndex());
+    mSnapshotSlider.setRange(0., std::max(1., lastSnapshot + 1.), 1.);
+}
+
+void AudioPluginAudioProcessorEditor::snapshotSliderChanged()
+{
+    const int64_t snapshot = static_cast<int64_t>(mSnapshotSlider.getMinValue());
+    const int64_t compare = static_cast<int64_t>(mSnapshotSlider.getMaxValue());
+    mMagnitudesComponent.setSnapshotView(snapshot - 1, snapshot > 0 ? compare - 1 : -1);
+    const juce::String unit = processorRef.isSnapshotPerBar() ? "Bar " : "Beat ";
+    if (snapshot == 0)
+        mSnapshotSlider.setTooltip("Live. Drag the left handle to a beat or bar, the right one to compare it with another.");
+    else if (compare == snapshot)
+        mSnapshotSlider.setTooltip(unit + juce::String(snapshot) + ".");
+    else
+        mSnapshotSlider.setTooltip(unit + juce::String(snapshot) + " vs " + juce::String(compare) + " (lines).");
 }
\ No newline at end of file
@@ -3,6 +3,10 @@
 #include "PluginProcessor.h"
 
 #include "../include/gui/MagnitudesComponent.h"
+#include "../include/gui/ChromaFeatureComponent.h"
+#include "../include/gui/OctaveMagnitudesComponent.h"
+#include "../include/gui/PitchReadoutComponent.h"
+#include "../include/gui/HarmonyReadoutComponent.h"
 #include "../include/gui/OtherLookAndFeel.h"
 
 //==============================================================================
@@ -21,6 +25,10 @@ private:
     void rangeSliderChanged();
     void tuningSliderChanged();
     void smoothingSliderChanged();
+    void historySliderChanged();
+    void alignedButtonClicked();
+    void snapshotSliderChanged();
+    void updateSnapshotRange();
 
     AudioPluginAudioProcessor& processorRef;
     juce::AudioProcessorValueTreeState& mParameters;
@@ -29,6 +37,9 @@ private:
     juce::Label mRangeLabel;
     juce::Label mTuningLabel;
     juce::Label mSmoothingLabel;
+    juce::Label mHistoryLabel;
+    juce::Label mZoomLabel;
+    juce::Label mSnapshotLabel;
     
     juce::Label mHeadingLabel;
     juce::Label mVersionLabel;
@@ -38,14 +49,22 @@ private:
     juce::TextButton mRightChannelButton{"R"};
     juce::TextButton mMidChannelButton{"M"};
     juce::TextButton mSideChannelButton{"S"};
+    juce::TextButton mAlignedButton{"Aligned"};
 
     juce::Slider mRangeSlider;
     juce::Slider mTuningSlider;
     juce::Slider mSmoothingSlider;
+    juce::Slider mHistorySlider;
+    juce::Slider mZoomSlider;
+    juce::Slider mSnapshotSlider;
 
     juce::TooltipWindow mFrequencyTooltip;
 
     MagnitudesComponent<BinsPerOctave, OctaveNumber> mMagnitudesComponent{ processorRef };
+    ChromaFeatureComponent mChromaFeatureComponent{ processorRef };
+    OctaveMagnitudesComponent<OctaveNumber> mOctaveMagnitudesComponent{ processorRef };
+    PitchReadoutComponent mPitchReadoutComponent{ processorRef };
+    HarmonyReadoutComponent mHarmonyReadoutComponent{ processorRef };
 
     OtherLookAndFeel mOtherLookAndFeel;
 
@@ -1,6 +1,51 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout()
+{
+    juce::AudioProcessorValueTreeState::ParameterLayout layout
+    {
+        std::make_unique<juce::AudioParameterInt> ("channel", "Channel", 0, 3, 0),
+        std::make_unique<juce::AudioParameterFloat> ("tuning", "Tuning", 415.305f, 466.164f, 440.f),
+        std::make_unique<juce::AudioParameterFloat> ("rangeMin", "RangeMin", -100.f, 40.f, -50.f),
+        std::make_unique<juce::AudioParameterFloat> ("rangeMax", "RangeMax", -100.f, 40.f, 10.f),
+        std::make_unique<juce::AudioParameterFloat> ("attackMs", "Attack", juce::NormalisableRange<float> (0.f, 2000.f, 0.f, 0.3f), 40.f),
+        std::make_unique<juce::AudioParameterFloat> ("releaseMs", "Release", juce::NormalisableRange<float> (0.f, 2000.f, 0.f, 0.3f), 150.f),
+        std::make_unique<juce::AudioParameterFloat> ("cpuBudget", "CpuBudget", 0.05f, 1.f, 0.5f),
+        std::make_unique<juce::AudioParameterBool> ("instantaneousFrequency", "InstantaneousFrequency", false),
+        std::make_unique<juce::AudioParameterFloat> ("minFrequency", "MinFrequency", juce::NormalisableRange<float> (10.f, 40000.f, 0.f, 0.2f), 10.f),
+        std::make_unique<juce::AudioParameterFloat> ("maxFrequency", "MaxFrequency", juce::NormalisableRange<float> (10.f, 40000.f, 0.f, 0.2f), 40000.f),
+        std::make_unique<juce::AudioParameterBool> ("timeAligned", "TimeAligned", false),
+        std::make_unique<juce::AudioParameterChoice> ("snapshotResolution", "SnapshotResolution", juce::StringArray{ "Beat", "Bar" }, 1),
+        std::make_unique<juce::AudioParameterBool> ("recordWhilePlaying", "RecordWhilePlaying", false)
+    };
+    for (int o = 0; o < OctaveNumber; o++)
+    {
+        layout.add(std::make_unique<juce::AudioParameterChoice> ("overlap" + juce::String(o), "Overlap" + juce::String(o),
+            juce::StringArray{ "1x", "2x", "4x", "8x", "1/2x", "1/4x" }, 0));
+    }
+    return layout;
+}
+
+// The history file holds hours of frames, so it goes to the user's cache on disk. The temp directory
+// is often a tmpfs, where the pages dropped from memory would stay in RAM anyway.
+static juce::File getHistoryDirectory()
+{
+#if JUCE_MAC
+    auto cache = juce::File::getSpecialLocation(juce::File::userHomeDirectory).getChildFile("Library/Caches");
+#elif JUCE_LINUX || JUCE_BSD
+    const auto xdgCache = juce::SystemStats::getEnvironmentVariable("XDG_CACHE_HOME", {});
+    auto cache = juce::File::isAbsolutePath(xdgCache) ? juce::File(xdgCache)
+        : juce::File::getSpecialLocation(juce::File::userHomeDirectory).getChildFile(".cache");
+#else
+    auto cache = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory);
+#endif
+    const auto directory = cache.getChildFile("CqtAnalyzer");
+    if (directory.createDirectory().wasOk())
+        return directory;
+    return juce::File::getSpecialLocation(juce::File::tempDirectory);
+}
+
 //==============================================================================
 AudioPluginAudioProcessor::AudioPluginAudioProcessor()
      : AudioProcessor (BusesProperties()
@@ -11,43 +56,70 @@ AudioPluginAudioProcessor::AudioPluginAudioProcessor()
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
                        ),
-        mParameters (*this, nullptr, juce::Identifier ("CqtAnalyzer"), 
-        {
-            std::make_unique<juce::AudioParameterInt> ("channel", "Channel", 0, 3, 0),
-            std::make_unique<juce::AudioParameterFloat> ("tuning", "Tuning", 415.305f, 466.164f, 440.f),
-            std::make_unique<juce::AudioParameterFloat> ("rangeMin", "RangeMin", -100.f, 40.f, -50.f),
-            std::make_unique<juce::AudioParameterFloat> ("rangeMax", "RangeMax", -100.f, 40.f, 10.f),
-            std::make_unique<juce::AudioParameterFloat> ("smoothingUp", "SmoothingUp", 0.f, 1.f, 0.7f),
-            std::make_unique<juce::AudioParameterFloat> ("smoothingDown", "SmoothingDown", 0.f, 1.f, 0.9f)
-        })
+        mParameters (*this, nullptr, juce::Identifier ("CqtAnalyzer"), createParameterLayout())
 {
     mChannelParameter = dynamic_cast<juce::AudioParameterInt*>(mParameters.getParameter("channel"));
     mTuningParameter = dynamic_cast<juce::AudioParameterFloat*>(mParameters.getParameter("tuning"));
     mRangeMinParameter = dynamic_cast<juce::AudioParameterFloat*>(mParameters.getParameter("rangeMin"));
     mRangeMaxParameter = dynamic_cast<juce::AudioParameterFloat*>(mParameters.getParameter("rangeMax"));
-    mSmoothingUpParameter = dynamic_cast<juce::AudioParameterFloat*>(mParameters.getParameter("smoothingUp"));
-    mSmoothingDownParameter = dynamic_cast<juce::AudioParameterFloat*>(mParameters.getParameter("smoothingDown"));
-
-    for (int i = 0; i < OctaveNumber; i++)
-    {
-        Cqt::ScheduleElement schedule;
-        schedule.octave = i;
-        mCqtTimers.push_back(std::make_unique<TimerMt>(std::bind(&AudioPluginAudioProcessor::threadedCqtCall, this, schedule)));
-    }
-
-    // reset feature buffers
+    mAttackParameter = dynamic_cast<juce::AudioParameterFloat*>(mParameters.getParameter("attackMs"));
+    mReleaseParameter = dynamic_cast<juce::AudioParameterFloat*>(mParameters.getParameter("releaseMs"));
+    mCpuBudgetParameter = dynamic_cast<juce::AudioParameterFloat*>(mParameters.getParameter("cpuBudget"));
+    mMinFrequencyParameter = dynamic_cast<juce::AudioParameterFloat*>(mParameters.getParameter("minFrequency"));
+    mMaxFrequencyParameter = dynamic_cast<juce::AudioParameterFloat*>(mParameters.getParameter("maxFrequency"));
+    mInstantaneousFrequencyParameter = dynamic_cast<juce::AudioParameterBool*>(mParameters.getParameter("instantaneousFrequency"));
+    mTimeAlignedParameter = dynamic_cast<juce::AudioParameterBool*>(mParameters.getParameter("timeAligned"));
+    mSnapshotResolutionParameter = dynamic_cast<juce::AudioParameterChoice*>(mParameters.getParameter("snapshotResolution"));
+    mRecordWhilePlayingParameter = dynamic_cast<juce::AudioParameterBool*>(mParameters.getParameter("recordWhilePlaying"));
     for (int o = 0; o < OctaveNumber; o++)
     {
-        for (int tone = 0; tone < BinsPerOctave; tone++)
-        {
-            mCqtDataStorage[o][tone] = 0.;
-            mKernelFreqs[o][tone] = 0.;
-        }
+        const juce::String parameterID = "overlap" + juce::String(o);
+        mOverlapParameters[o] = dynamic_cast<juce::AudioParameterChoice*>(mParameters.getParameter(parameterID));
+        mParameters.addParameterListener(parameterID, this);
     }
+    mParameters.addParameterListener("minFrequency", this);
+    mParameters.addParameterListener("maxFrequency", this);
+    mParameters.addParameterListener("cpuBudget", this);
+    mEngine.setCpuBudget(mCpuBudgetParameter->get());
+    mParameters.addParameterListener("instantaneousFrequency", this);
+    mParameters.addParameterListener("attackMs", this);
+    mParameters.addParameterListener("releaseMs", this);
+    mEngine.setBallistics(mAttackParameter->get(), mReleaseParameter->get());
+    mEngine.setInstantaneousFrequency(mInstantaneousFrequencyParameter->get());
+    mParameters.addParameterListener("snapshotResolution", this);
+    mEngine.setSnapshotResolution(mSnapshotResolutionParameter->getIndex() == 0 ? SnapshotResolution::Beat : SnapshotResolution::Bar);
+
+    // history spills into a memory-mapped file, unlinked once it is mapped
+    const auto historyFile = getHistoryDirectory().getNonexistentChildFile("CqtAnalyzerHistory", ".bin");
+    mEngine.openHistory(historyFile.getFullPathName().toStdString());
+
+    // every completed octave frame is published for local consumers
+#if ! JUCE_WINDOWS
+    static std::atomic<int> instanceCounter{ 0 };
+    const auto publisherName = "/CqtAnalyzer-" + std::to_string(::getpid()) + "-" + std::to_string(instanceCounter++);
+    mEngine.openPublisher(publisherName);
+#endif
+
+    // nothing consumes the analysis yet, shared-memory readers are polled for
+    updateSuspension();
+    startTimer(ConsumerPollMs);
 }
 
 AudioPluginAudioProcessor::~AudioPluginAudioProcessor()
 {
+    for (int o = 0; o < OctaveNumber; o++)
+    {
+        mParameters.removeParameterListener("overlap" + juce::String(o), this);
+    }
+    mParameters.removeParameterListener("minFrequency", this);
+    mParameters.removeParameterListener("maxFrequency", this);
+    mParameters.removeParameterListener("cpuBudget", this);
+    mParameters.removeParameterListener("instantaneousFrequency", this);
+    mParameters.removeParameterListener("attackMs", this);
+    mParameters.removeParameterListener("releaseMs", this);
+    mParameters.removeParameterListener("snapshotResolution", this);
+    cancelPendingUpdate();
+    stopTimer();
 }
 
 //==============================================================================
@@ -123,46 +195,14 @@ void AudioPluginAudioProcessor::changeProgramName (int index, const juce::String
 //==============================================================================
 void AudioPluginAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    // mutex
-
-    // initialize the cqt
-    std::vector<int> hopSizes(OctaveNumber);
-    for (int o = 0; o < OctaveNumber; o++)
-    {
-        hopSizes[o] = Cqt::Fft_Size / std::pow(2, o);
-    }
-    mCqt.init(hopSizes);
-    mCqt.initFs(sampleRate, samplesPerBlock);
-    mCqtSampleBuffer.resize(samplesPerBlock, 0.);
-
-    // reset feature buffers
-    for (int o = 0; o < OctaveNumber; o++)
-    {
-        for (int tone = 0; tone < BinsPerOctave; tone++)
-        {
-            mCqtDataStorage[o][tone] = 0.;
-            mKernelFreqs[o][tone] = 0.;
-        }
-    }
-
-    // configure timers
-    for (int i = 0; i < OctaveNumber; i++)
-    {
-        mCqtTimers[i]->stop();
-        mCqtTimers[i]->setSingleShot(false);
-        mCqtTimers[i]->setInterval(std::chrono::milliseconds(static_cast<size_t>(mCqt.getLatencyMs(i))));
-        mCqtTimers[i]->start(true);
-    }
-
-    const auto kernelFreqs = mCqt.getKernelFreqs();
     for (int o = 0; o < OctaveNumber; o++)
     {
-        for (int tone = 0; tone < BinsPerOctave; tone++)
-        {
-            mKernelFreqs[o][tone] = kernelFreqs[o][tone];
-        }
+        mEngine.setOctaveOverlap(o, getOctaveOverlap(o));
+        mEngine.setOctaveRateDivisor(o, getOctaveRateDivisor(o));
     }
-    mNewKernelFreqs = true;
+    mEngine.setFrequencyRange(mMinFrequencyParameter->get(), mMaxFrequencyParameter->get());
+    mEngine.prepare(sampleRate, samplesPerBlock);
+    mEngine.setTuning(mTuningParameter->get());
 }
 
 void AudioPluginAudioProcessor::releaseResources()
@@ -200,7 +240,9 @@ void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
 {
     juce::ignoreUnused (midiMessages);
 
+    RealtimeChecks::ScopedRealtimeThread realtimeThread;
     juce::ScopedNoDenormals noDenormals;
+    double* cqtSampleBuffer = mEngine.getInputBuffer();
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -215,7 +257,7 @@ void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
             auto* channelDataL = buffer.getReadPointer (0);
             for(int s = 0; s < buffer.getNumSamples(); s++)
             {
-                mCqtSampleBuffer[s] = static_cast<double>(channelDataL[s]);
+                cqtSampleBuffer[s] = static_cast<double>(channelDataL[s]);
             }
             break;
         }
@@ -224,7 +266,7 @@ void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
             auto* channelDataR = buffer.getReadPointer (1);
             for(int s = 0; s < buffer.getNumSamples(); s++)
             {
-                mCqtSampleBuffer[s] = static_cast<double>(channelDataR[s]);
+                cqtSampleBuffer[s] = static_cast<double>(channelDataR[s]);
             }
             break;
         }
@@ -234,7 +276,7 @@ void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
             auto* channelDataR = buffer.getReadPointer (1);
             for(int s = 0; s < buffer.getNumSamples(); s++)
             {
-                mCqtSampleBuffer[s] = static_cast<double>(channelDataL[s] + channelDataR[s]);
+                cqtSampleBuffer[s] = static_cast<double>(channelDataL[s] + channelDataR[s]);
             }
             break;
         }
@@ -244,14 +286,15 @@ void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
             auto* channelDataR = buffer.getReadPointer (1);
             for(int s = 0; s < buffer.getNumSamples(); s++)
             {
-                mCqtSampleBuffer[s] = static_cast<double>(channelDataL[s] - channelDataR[s]);
+                cqtSampleBuffer[s] = static_cast<double>(channelDataL[s] - channelDataR[s]);
             }
             break;
         }
         default:
         break;
     }
-    mCqt.inputBlock(mCqtSampleBuffer.data(), buffer.getNumSamples());
+    updateTransport();
+    mEngine.processInput(buffer.getNumSamples());
 }
 
 void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer,
@@ -259,7 +302,9 @@ void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer,
 {
     juce::ignoreUnused (midiMessages);
 
+    RealtimeChecks::ScopedRealtimeThread realtimeThread;
     juce::ScopedNoDenormals noDenormals;
+    double* cqtSampleBuffer = mEngine.getInputBuffer();
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
     
@@ -274,7 +319,7 @@ void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer,
             auto* channelDataL = buffer.getReadPointer (0);
             for(int s = 0; s < buffer.getNumSamples(); s++)
             {
-                mCqtSampleBuffer[s] = static_cast<double>(channelDataL[s]);
+                cqtSampleBuffer[s] = static_cast<double>(channelDataL[s]);
             }
             break;
         }
@@ -283,7 +328,7 @@ void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer,
             auto* channelDataR = buffer.getReadPointer (1);
             for(int s = 0; s < buffer.getNumSamples(); s++)
             {
-                mCqtSampleBuffer[s] = static_cast<double>(channelDataR[s]);
+                cqtSampleBuffer[s] = static_cast<double>(channelDataR[s]);
             }
             break;
         }
@@ -293,7 +338,7 @@ void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer,
             auto* channelDataR = buffer.getReadPointer (1);
             for(int s = 0; s < buffer.getNumSamples(); s++)
             {
-                mCqtSampleBuffer[s] = static_cast<double>(channelDataL[s] + channelDataR[s]);
+                cqtSampleBuffer[s] = static_cast<double>(channelDataL[s] + channelDataR[s]);
             }
             break;
         }
@@ -303,14 +348,15 @@ void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer,
             auto* channelDataR = buffer.getReadPointer (1);
             for(int s = 0; s < buffer.getNumSamples(); s++)
             {
-                mCqtSampleBuffer[s] = static_cast<double>(channelDataL[s] - channelDataR[s]);
+                cqtSampleBuffer[s] = static_cast<double>(channelDataL[s] - channelDataR[s]);
             }
             break;
         }
         default:
         break;
     }
-    mCqt.inputBlock(mCqtSampleBuffer.data(), buffer.getNumSamples());
+    updateTransport();
+    mEngine.processInput(buffer.getNumSamples());
 }
 
 //==============================================================================
@@ -332,13 +378,37 @@ void AudioPluginAudioProcessor::getStateInformation (juce::MemoryBlock& destData
     copyXmlToBinary (*xml, destData);
 }
 
+// Sessions saved before attackMs and releaseMs held smoothingUp and smoothingDown, one-pole
+// coefficients per 15 ms display frame. They become the time constants with the same response.
+static void migrateSmoothingParameters(juce::ValueTree& state)
+{
+    constexpr double legacyFrameMs = 15.;
+    const std::pair<const char*, const char*> renamed[] = { { "smoothingUp", "attackMs" }, { "smoothingDown", "releaseMs" } };
+    for (const auto& [oldID, newID] : renamed)
+    {
+        auto oldParameter = state.getChildWithProperty("id", oldID);
+        if (!oldParameter.isValid())
+            continue;
+        const double coefficient = oldParameter.getProperty("value");
+        const double timeConstantMs = coefficient <= 0. ? 0.
+            : coefficient >= 1. ? 2000. : std::min(2000., -legacyFrameMs / std::log(coefficient));
+        state.removeChild(oldParameter, nullptr);
+        if (!state.getChildWithProperty("id", newID).isValid())
+            state.appendChild(juce::ValueTree("PARAM", { { "id", newID }, { "value", timeConstantMs } }), nullptr);
+    }
+}
+
 void AudioPluginAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
     std::unique_ptr<juce::XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
  
     if (xmlState.get() != nullptr)
         if (xmlState->hasTagName (mParameters.state.getType()))
-            mParameters.replaceState (juce::ValueTree::fromXml (*xmlState));
+        {
+            auto state = juce::ValueTree::fromXml (*xmlState);
+            migrateSmoothingParameters(state);
+            mParameters.replaceState (state);
+        }
 }
 
 //==============================================================================
@@ -353,16 +423,7 @@ juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 void AudioPluginAudioProcessor::setTuning(const double tuning)
 { 
     *mTuningParameter = tuning;
-    mCqt.setConcertPitch(tuning); 
-    const auto kernelFreqs = mCqt.getKernelFreqs();
-    for (int o = 0; o < OctaveNumber; o++)
-    {
-        for (int tone = 0; tone < BinsPerOctave; tone++)
-        {
-            mKernelFreqs[o][tone] = kernelFreqs[o][tone];
-        }
-    }
-    mNewKernelFreqs = true;
+    mEngine.setTuning(tuning);
 }
 
 void AudioPluginAudioProcessor::setChannel(const int channel)
@@ -370,10 +431,10 @@ void AudioPluginAudioProcessor::setChannel(const int channel)
     *mChannelParameter = channel; 
 };
 
-void AudioPluginAudioProcessor::setSmoothing(const double smoothingUp, const double smoothingDown)
+void AudioPluginAudioProcessor::setBallistics(const double attackMs, const double releaseMs)
 {
-    *mSmoothingUpParameter = smoothingUp;
-    *mSmoothingDownParameter = smoothingDown;
+    *mAttackParameter = attackMs;
+    *mReleaseParameter = releaseMs;
 }
 
 void AudioPluginAudioProcessor::setRange(const double rangeMin, const double rangeMax)
@@ -382,17 +443,210 @@ void AudioPluginAudioProcessor::setRange(const double rangeMin, const double ran
     *mRangeMaxParameter = rangeMax;
 }
 
-void AudioPluginAudioProcessor::threadedCqtCall(const Cqt::ScheduleElement schedule)
+void AudioPluginAudioProcessor::setTimeAligned(const bool timeAligned)
+{
+    *mTimeAlignedParameter = timeAligned;
+}
+
+bool AudioPluginAudioProcessor::isTimeAligned() const
+{
+    return mTimeAlignedParameter->get();
+}
+
+void AudioPluginAudioProcessor::setRecordWhilePlaying(const bool recordWhilePlaying)
+{
+    *mRecordWhilePlayingParameter = recordWhilePlaying;
+}
+
+bool AudioPluginAudioProcessor::isRecordingWhilePlaying() const
+{
+    return mRecordWhilePlayingParameter->get();
+}
+
+bool AudioPluginAudioProcessor::readSnapshot(const int64_t index, double frame[OctaveNumber][BinsPerOctave]) const
+{
+    return mEngine.getSnapshots().read(index, frame);
+}
+
+int64_t AudioPluginAudioProcessor::getLastSnapshotIndex() const
+{
+    return mEngine.getSnapshots().getLastIndex();
+}
+
+bool AudioPluginAudioProcessor::isSnapshotPerBar() const
+{
+    return mEngine.getSnapshots().getResolution() == SnapshotResolution::Bar;
+}
+
+void AudioPluginAudioProcessor::updateTransport()
+{
+    // the host's position is only valid during processBlock, the snapshots are averaged on the octave threads
+    bool playing = false;
+    double ppq = 0.;
+    double bpm = 120.;
+    int numerator = 4;
+    int denominator = 4;
+    if (auto* playHead = getPlayHead())
+    {
+        if (const auto position = playHead->getPosition())
+        {
+            playing = position->getIsPlaying() && position->getPpqPosition().hasValue();
+            ppq = position->getPpqPosition().orFallback(0.);
+            bpm = position->getBpm().orFallback(120.);
+            if (const auto timeSignature = position->getTimeSignature())
+            {
+                numerator = timeSignature->numerator;
+                denominator = timeSignature->denominator;
+            }
+        }
+    }
+    mEngine.setTransport(playing, ppq, bpm, numerator, denominator);
+    mTransportPlaying.store(playing, std::memory_order_relaxed);
+}
+
+void AudioPluginAudioProcessor::setFrequencyRange(const double minFrequency, const double maxFrequency)
+{
+    *mMinFrequencyParameter = minFrequency;
+    *mMaxFrequencyParameter = maxFrequency;
+}
+
+void AudioPluginAudioProcessor::setOctaveOverlap(const int octave, const int overlap)
+{
+    int index = 0;
+    while (index < OverlapChoices - 1 && (1 << index) < overlap)
+    {
+        index++;
+    }
+    *mOverlapParameters[octave] = index;
+}
+
+int AudioPluginAudioProcessor::getOctaveOverlap(const int octave) const
+{
+    const int index = mOverlapParameters[octave]->getIndex();
+    return index < OverlapChoices ? 1 << index : 1;
+}
+
+void AudioPluginAudioProcessor::setOctaveRateDivisor(const int octave, const int divisor)
 {
-    mCqt.cqt(schedule);
-    auto cqtData = mCqt.getOctaveCqtBuffer(schedule.octave);
-    for (size_t tone = 0; tone < BinsPerOctave; tone++)
+    int index = 0;
+    while (index < RateDivisorChoices && (2 << index) <= divisor)
     {
-        const double realD = (*cqtData)[tone].real();
-        const double imagD = (*cqtData)[tone].imag();
-        const double magnitude = std::sqrt(std::pow(realD, 2) + std::pow(imagD, 2));
-        mCqtDataStorage[schedule.octave][tone] = magnitude;
+        index++;
     }
+    *mOverlapParameters[octave] = index > 0 ? OverlapChoices + index - 1 : 0;
 }
 
+int AudioPluginAudioProcessor::getOctaveRateDivisor(const int octave) const
+{
+    const int index = mOverlapParameters[octave]->getIndex();
+    return index < OverlapChoices ? 1 : 2 << (index - OverlapChoices);
+}
+
+double AudioPluginAudioProcessor::getOctaveUpdateIntervalMs(const int octave) const
+{
+    return mEngine.getOctaveUpdateIntervalMs(octave);
+}
+
+void AudioPluginAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
+{
+    if (parameterID == "cpuBudget")
+    {
+        mEngine.setCpuBudget(newValue);
+        return;
+    }
+    if (parameterID == "attackMs" || parameterID == "releaseMs")
+    {
+        mEngine.setBallistics(mAttackParameter->get(), mReleaseParameter->get());
+        return;
+    }
+    if (parameterID == "instantaneousFrequency")
+    {
+        mEngine.setInstantaneousFrequency(newValue >= 0.5f);
+        return;
+    }
+    if (parameterID == "snapshotResolution")
+    {
+        mEngine.setSnapshotResolution(juce::roundToInt(newValue) == 0 ? SnapshotResolution::Beat : SnapshotResolution::Bar);
+        return;
+    }
+    // may arrive on the audio thread, the re-initialization happens on the message thread
+    triggerAsyncUpdate();
+}
 
+void AudioPluginAudioProcessor::handleAsyncUpdate()
+{
+    if (getSampleRate() <= 0.)
+        return;
+    suspendProcessing(true);
+    prepareToPlay(getSampleRate(), getBlockSize());
+    suspendProcessing(false);
+}
+
+bool AudioPluginAudioProcessor::readHistory(const double secondsAgo, const int level, double frame[OctaveNumber][BinsPerOctave]) const
+{
+    return mEngine.readHistory(secondsAgo, level, frame);
+}
+
+double AudioPluginAudioProcessor::getHistoryLengthSeconds(const int level) const
+{
+    return mEngine.getHistoryLengthSeconds(level);
+}
+
+int AudioPluginAudioProcessor::getHistoryLevels() const
+{
+    return mEngine.getHistoryLevels();
+}
+
+juce::String AudioPluginAudioProcessor::getSharedMemoryName() const
+{
+    return mEngine.getSharedMemoryName();
+}
+
+juce::String AudioPluginAudioProcessor::getWorkerPolicy() const
+{
+    return ThreadPolicy::getInstance().getReport();
+}
+
+void AudioPluginAudioProcessor::setVirtualClock(const bool enabled)
+{
+    mEngine.setVirtualClock(enabled);
+}
+
+void AudioPluginAudioProcessor::advanceVirtualClock()
+{
+    mEngine.advanceVirtualClock();
+}
+
+void AudioPluginAudioProcessor::setFrameListener(FrameListener listener)
+{
+    mHasFrameListener = listener != nullptr;
+    mEngine.setFrameListener(std::move(listener));
+    updateSuspension();
+}
+
+void AudioPluginAudioProcessor::addConsumer()
+{
+    mNumConsumers++;
+    updateSuspension();
+}
+
+void AudioPluginAudioProcessor::removeConsumer()
+{
+    jassert(mNumConsumers > 0);
+    mNumConsumers--;
+    updateSuspension();
+}
+
+void AudioPluginAudioProcessor::timerCallback()
+{
+    updateSuspension();
+}
+
+void AudioPluginAudioProcessor::updateSuspension()
+{
+    // with recordWhilePlaying on, history and snapshots keep recording what the host plays, with or without an editor
+    const bool recording = mRecordWhilePlayingParameter->get() && mTransportPlaying.load(std::memory_order_relaxed);
+    const bool consumed = mNumConsumers > 0 || mHasFrameListener || recording
+        || mEngine.hasSharedMemoryReader(std::chrono::milliseconds(SharedMemoryReaderTimeoutMs));
+    mEngine.setSuspended(!consumed);
+}
\ No newline at end of file
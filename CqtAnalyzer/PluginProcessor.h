@@ -1,14 +1,22 @@
 #pragma once
 
 #include <juce_audio_processors/juce_audio_processors.h>
-#include "../include/TimerMt.h"
-#include "../submodules/rt-cqt/include/ConstantQTransform.h"
+#include "../include/CqtEngine.h"
+#include "../include/RealtimeChecks.h"
 
 constexpr int BinsPerOctave{ 48 };
 constexpr int OctaveNumber{ 10 };
+constexpr int OverlapChoices{ 4 }; // 1x, 2x, 4x, 8x
+constexpr int RateDivisorChoices{ 2 }; // 1/2x, 1/4x, after the overlaps
+// short enough that a snapshot started with playback misses little of its first beat
+constexpr int ConsumerPollMs{ 100 };
+constexpr int SharedMemoryReaderTimeoutMs{ 3000 };
 
 //==============================================================================
-class AudioPluginAudioProcessor  : public juce::AudioProcessor
+class AudioPluginAudioProcessor  : public juce::AudioProcessor,
+                                   private juce::AudioProcessorValueTreeState::Listener,
+                                   private juce::AsyncUpdater,
+                                   private juce::Timer
 {
 public:
     //==============================================================================
@@ -50,29 +58,108 @@ public:
     void setStateInformation (const void* data, int sizeInBytes) override;
 
     //==============================================================================
-    double mCqtDataStorage[OctaveNumber][BinsPerOctave];
-    double mKernelFreqs[OctaveNumber][BinsPerOctave];
-    bool mNewKernelFreqs{false};
+    // magnitudes, kernel frequencies and features live in the engine
+    CqtEngine<BinsPerOctave, OctaveNumber>& getEngine() { return mEngine; }
+    const CqtEngine<BinsPerOctave, OctaveNumber>& getEngine() const { return mEngine; }
     void setTuning(const double tuning);
     void setChannel(const int channel);
-    void setSmoothing(const double smoothingUp, const double smoothingDown);
+    // attack and release time constants of the displayed magnitudes
+    void setBallistics(const double attackMs, const double releaseMs);
     void setRange(const double rangeMin, const double rangeMax);
+
+    bool readHistory(const double secondsAgo, const int level, double frame[OctaveNumber][BinsPerOctave]) const;
+    double getHistoryLengthSeconds(const int level) const;
+    int getHistoryLevels() const;
+
+    juce::String getSharedMemoryName() const;
+    size_t getArenaBytes() const { return mEngine.getArenaBytes(); }
+    // scheduling policy the analysis workers run with, see ThreadPolicy
+    juce::String getWorkerPolicy() const;
+
+    const FeatureExtractor<BinsPerOctave, OctaveNumber>& getFeatures() const { return mEngine.getFeatures(); }
+    std::array<PitchEstimate, PitchMaxVoices> getPitchEstimates() const { return mEngine.getPitchEstimates(); }
+    const OnsetDetector<BinsPerOctave, OctaveNumber>& getOnsets() const { return mEngine.getOnsets(); }
+    KeyChordEstimate getKeyChord() const { return mEngine.getKeyChord(); }
+
+    // 0 is full quality, higher levels thin out the highest octaves
+    int getQualityLevel() const { return mEngine.getQualityLevel(); }
+    double getAnalysisLoad() const { return mEngine.getAnalysisLoad(); }
+
+    // Octaves entirely outside the range are not analysed. Changes re-prepare the engine on the message thread.
+    void setFrequencyRange(const double minFrequency, const double maxFrequency);
+    bool isOctaveActive(const int octave) const { return mEngine.isOctaveActive(octave); }
+
+    // The time-aligned display shows every octave at the instant its slowest window is centred on,
+    // instead of each octave's newest frame, and trails the input by getAlignedLatencyMs.
+    void setTimeAligned(const bool timeAligned);
+    bool isTimeAligned() const;
+    double getAlignedLatencyMs() const { return mEngine.getAlignedLatencyMs(); }
+
+    // Average spectrum of every beat or bar of the host timeline (parameter snapshotResolution),
+    // index 0 is the first one from the song start. Returns false if it was not captured.
+    bool readSnapshot(const int64_t index, double frame[OctaveNumber][BinsPerOctave]) const;
+    int64_t getLastSnapshotIndex() const;
+    bool isSnapshotPerBar() const;
+    // Keeps the history and snapshots recording while the host transport plays, without an editor
+    // or other consumer attached. Picked up by the consumer poll within ConsumerPollMs.
+    void setRecordWhilePlaying(const bool recordWhilePlaying);
+    bool isRecordingWhilePlaying() const;
+
+    // Hop overlap of each octave relative to the default hop, 1, 2, 4 or 8. Changes re-prepare the engine
+    // on the message thread, the update interval follows.
+    void setOctaveOverlap(const int octave, const int overlap);
+    int getOctaveOverlap(const int octave) const;
+    // Divides the update rate of an octave by 2 or 4 instead, e.g. to thin out the high octaves. Shares
+    // the octave's parameter with the overlap, setting one resets the other to 1.
+    void setOctaveRateDivisor(const int octave, const int divisor);
+    int getOctaveRateDivisor(const int octave) const;
+    double getOctaveUpdateIntervalMs(const int octave) const;
+
+    // Deterministic scheduling for offline tools: call setVirtualClock before prepareToPlay, then
+    // advanceVirtualClock after every processBlock instead of relying on the timer threads.
+    void setVirtualClock(const bool enabled);
+    void advanceVirtualClock();
+
+    using FrameListener = CqtEngine<BinsPerOctave, OctaveNumber>::FrameListener;
+    // a frame listener counts as consumer
+    void setFrameListener(FrameListener listener);
+
+    // The analysis only runs while something consumes it: an open editor, a frame listener, a reader
+    // of the shared-memory ring, or, with recordWhilePlaying on, the history and snapshots while the
+    // host transport plays. Editors and other readers of the engine register here, message thread.
+    void addConsumer();
+    void removeConsumer();
+    bool isAnalysisSuspended() const { return mEngine.isSuspended(); }
 private:
     //==============================================================================
-    std::vector<double> mCqtSampleBuffer;
-    Cqt::ConstantQTransform<BinsPerOctave, OctaveNumber> mCqt;
+    CqtEngine<BinsPerOctave, OctaveNumber> mEngine;
 
-    void threadedCqtCall(const Cqt::ScheduleElement schedule);
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+    void handleAsyncUpdate() override;
+    void timerCallback() override;
+    void updateSuspension();
+    void updateTransport();
 
-    std::vector<std::unique_ptr<TimerMt>> mCqtTimers;
+    int mNumConsumers{ 0 };
+    bool mHasFrameListener{ false };
+    // set by the audio thread from the host's playhead
+    std::atomic<bool> mTransportPlaying{ false };
 
     juce::AudioProcessorValueTreeState mParameters;
     juce::AudioParameterInt* mChannelParameter{ nullptr };
     juce::AudioParameterFloat* mTuningParameter{ nullptr };
     juce::AudioParameterFloat* mRangeMinParameter{ nullptr };
     juce::AudioParameterFloat* mRangeMaxParameter{ nullptr };
-    juce::AudioParameterFloat* mSmoothingUpParameter{ nullptr };
-    juce::AudioParameterFloat* mSmoothingDownParameter{ nullptr };
+    juce::AudioParameterFloat* mAttackParameter{ nullptr };
+    juce::AudioParameterFloat* mReleaseParameter{ nullptr };
+    juce::AudioParameterFloat* mCpuBudgetParameter{ nullptr };
+    juce::AudioParameterBool* mInstantaneousFrequencyParameter{ nullptr };
+    juce::AudioParameterBool* mTimeAlignedParameter{ nullptr };
+    juce::AudioParameterChoice* mSnapshotResolutionParameter{ nullptr };
+    juce::AudioParameterBool* mRecordWhilePlayingParameter{ nullptr };
+    juce::AudioParameterFloat* mMinFrequencyParameter{ nullptr };
+    juce::AudioParameterFloat* mMaxFrequencyParameter{ nullptr };
+    juce::AudioParameterChoice* mOverlapParameters[OctaveNumber];
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioPluginAudioProcessor)
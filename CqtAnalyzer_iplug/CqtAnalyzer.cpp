@@ -114,12 +114,7 @@ CqtAnalyzer::CqtAnalyzer(const InstanceInfo& info)
 #endif
 
 #if IPLUG_DSP
-  for (int i = 0; i < OctaveNumber; i++)
-  {
-      Cqt::ScheduleElement schedule;
-      schedule.octave = i;
-      mCqtTimers.push_back(std::make_unique<TimerMt>(std::bind(&CqtAnalyzer::threadedCqtCall, this, schedule)));
-  }
+  mEngine.setFrameListener(std::bind(&CqtAnalyzer::sendOctave, this, std::placeholders::_1, std::placeholders::_3));
   mChromaFeatureTimer = std::make_unique<TimerMt>(std::bind(&CqtAnalyzer::updateChromaFeature, this));
   mOctaveMagnitudesTimer = std::make_unique<TimerMt>(std::bind(&CqtAnalyzer::updateOctaveMagnitudes, this));
 #endif
@@ -137,11 +132,12 @@ void CqtAnalyzer::ProcessBlock(sample** inputs, sample** outputs, int nFrames)
   }
 
   // send data into cqt filter bank
+  double* cqtSampleBuffer = mEngine.getInputBuffer();
   for (int i = 0; i < nFrames; i++)
   {
-      mCqtSampleBuffer[i] = inputs[mChannel][i];
+      cqtSampleBuffer[i] = inputs[mChannel][i];
   }
-  mCqt.inputBlock(mCqtSampleBuffer.data(), nFrames);
+  mEngine.processInput(nFrames);
 
   // bypass audio
   for (int s = 0; s < nFrames; s++) 
@@ -153,25 +149,19 @@ void CqtAnalyzer::ProcessBlock(sample** inputs, sample** outputs, int nFrames)
   }
 }
 
-void CqtAnalyzer::threadedCqtCall(const Cqt::ScheduleElement schedule)
+void CqtAnalyzer::sendOctave(const int octave, const double* magnitudes)
 {
-    mCqt.cqt(schedule);
-    auto cqtData = mCqt.getOctaveCqtBuffer(schedule.octave);
     // send data to gui
-    mSenderBuffer[schedule.octave].vals[0][0] = static_cast<double>(schedule.octave);
-    mSenderBuffer[schedule.octave].vals[0][1] = mMagMin;
-    mSenderBuffer[schedule.octave].vals[0][2] = mMagMax;
-    mSenderBuffer[schedule.octave].vals[0][3] = mTuning;
+    mSenderBuffer[octave].vals[0][0] = static_cast<double>(octave);
+    mSenderBuffer[octave].vals[0][1] = mMagMin;
+    mSenderBuffer[octave].vals[0][2] = mMagMax;
+    mSenderBuffer[octave].vals[0][3] = mTuning;
     for (size_t tone = 0; tone < BinsPerOctave; tone++)
     {
-        const double realD = (*cqtData)[tone].real();
-        const double imagD = (*cqtData)[tone].imag();
-        const double magnitude = std::sqrt(std::pow(realD, 2) + std::pow(imagD, 2));
-        mSenderBuffer[schedule.octave].vals[0][tone + 4] = magnitude;
-        mCqtDataStorage[schedule.octave][tone] = magnitude;
+        mSenderBuffer[octave].vals[0][tone + 4] = magnitudes[tone];
     }
     // push octave data
-    mCqtSender[schedule.octave].PushData(mSenderBuffer[schedule.octave]);
+    mCqtSender[octave].PushData(mSenderBuffer[octave]);
 }
 
 void CqtAnalyzer::OnReset()
@@ -181,24 +171,11 @@ void CqtAnalyzer::OnReset()
     const double samplerate = GetSampleRate();
     const int blockSize = GetBlockSize();
 
-    // initialize the cqt
-    std::vector<int> hopSizes(OctaveNumber);
-    for (int o = 0; o < OctaveNumber; o++)
-    {
-        hopSizes[o] = Cqt::Fft_Size / std::pow(2, o);
-    }
-    mCqt.init(hopSizes);
-    mCqt.initFs(samplerate, blockSize);
-    mCqtSampleBuffer.resize(blockSize, 0.);
+    // initialize the cqt, the engine schedules the octaves itself
+    mEngine.prepare(samplerate, blockSize);
+    mEngine.setTuning(mTuning);
 
     // reset feature buffers
-    for (int o = 0; o < OctaveNumber; o++)
-    {
-        for (int tone = 0; tone < BinsPerOctave; tone++)
-        {
-            mCqtDataStorage[o][tone] = 0.;
-        }
-    }
     for (int tone = 0; tone < BinsPerOctave; tone++)
     {
         mChromaFeature[tone] = 0.;
@@ -224,14 +201,6 @@ void CqtAnalyzer::OnReset()
     mOctaveMagnitudesBuffer.nChans = 1;
 
     // configure timers
-    for (int i = 0; i < OctaveNumber; i++)
-    {
-        mCqtTimers[i]->stop();
-        mCqtTimers[i]->setSingleShot(false);
-        mCqtTimers[i]->setInterval(std::chrono::milliseconds(static_cast<size_t>(mCqt.getLatencyMs(i))));
-        mCqtTimers[i]->start(true);
-    }
-
     mChromaFeatureTimer->stop();
     mChromaFeatureTimer->setSingleShot(false);
     mChromaFeatureTimer->setInterval(std::chrono::milliseconds(FeatureUpdateRate));
@@ -249,7 +218,7 @@ void CqtAnalyzer::OnParamChange(int paramIdx)
     {
         case kTuning:
         {
-            mCqt.setConcertPitch(GetParam(paramIdx)->Value());
+            mEngine.setTuning(GetParam(paramIdx)->Value());
             mTuning = GetParam(paramIdx)->Value();
             break;
         }
@@ -294,6 +263,8 @@ void CqtAnalyzer::OnIdle()
 
 void CqtAnalyzer::updateChromaFeature()
 {
+    double magnitudes[OctaveNumber][BinsPerOctave];
+    mEngine.readMagnitudes(magnitudes);
     for (int tone = 0; tone < BinsPerOctave; tone++)
     {
         mChromaFeature[tone] = 0.;
@@ -302,7 +273,7 @@ void CqtAnalyzer::updateChromaFeature()
     {
         for (int tone = 0; tone < BinsPerOctave; tone++)
         {
-            mChromaFeature[tone] += mCqtDataStorage[octave][tone];
+            mChromaFeature[tone] += magnitudes[octave][tone];
         }
     }
     // calculate mean magnitude
@@ -342,12 +313,14 @@ void CqtAnalyzer::updateChromaFeature()
 
 void CqtAnalyzer::updateOctaveMagnitudes()
 {
+    double magnitudes[OctaveNumber][BinsPerOctave];
+    mEngine.readMagnitudes(magnitudes);
     for (int octave = 0; octave < OctaveNumber; octave++)
     {
         mOctaveMagnitudes[octave] = 0.;
         for (int tone = 0; tone < BinsPerOctave; tone++)
         {
-            mOctaveMagnitudes[octave] += mCqtDataStorage[octave][tone];
+            mOctaveMagnitudes[octave] += magnitudes[octave][tone];
         }
     }
     // scale
@@ -4,8 +4,7 @@
 #include "IControls.h"
 
 #if IPLUG_DSP
-#include "../include/TimerMt.h"
-#include "../submodules/rt-cqt/include/ConstantQTransform.h"
+#include "../include/CqtEngine.h"
 #endif
 
 
@@ -48,8 +47,7 @@ public:
   void OnIdle()  override;
 
 private:
-  std::vector<double> mCqtSampleBuffer;
-  Cqt::ConstantQTransform<BinsPerOctave, OctaveNumber> mCqt;
+  CqtEngine<BinsPerOctave, OctaveNumber> mEngine;
 
   ISender<1, 64, std::array<double, OctaveBufferSize> > mCqtSender[OctaveNumber];
   ISenderData<1, std::array<double, OctaveBufferSize> > mSenderBuffer[OctaveNumber];
@@ -62,15 +60,13 @@ private:
 
   WDL_Mutex mMutex;
   
-  void threadedCqtCall(const Cqt::ScheduleElement schedule);
+  void sendOctave(const int octave, const double* magnitudes);
   void updateChromaFeature();
   void updateOctaveMagnitudes();
 
-  std::vector<std::unique_ptr<TimerMt>> mCqtTimers;
   std::unique_ptr<TimerMt> mChromaFeatureTimer;
   std::unique_ptr<TimerMt> mOctaveMagnitudesTimer;
 
-  double mCqtDataStorage[OctaveNumber][BinsPerOctave];
   double mChromaFeature[BinsPerOctave];
   double mOctaveMagnitudes[OctaveNumber];
 
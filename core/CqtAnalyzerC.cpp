@@ -0,0 +1,318 @@
+// C interface around CqtEngine, see cqtanalyzer.h.
+// Frames travel through ring slots: octave threads take a slot from the free queue, fill it and put it
+// on the ready queue, the caller polls from the ready queue and hands the slot back to the free queue
+// on release, in any order. Both are bounded multi-producer multi-consumer queues of slot indices.
+// The caller gets a lease: a descriptor taken from a pool on poll and only reissued after it has been
+// released, so its address identifies the lease. Each lease records the epoch it was handed out in,
+// every prepare starts a new epoch and releases of leases from an older one only return the descriptor.
+
+#define CQT_ANALYZER_BUILD
+#include "cqtanalyzer.h"
+
+#include "../include/CqtEngine.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace
+{
+    constexpr int AnalyzerBinsPerOctave{ 48 };
+    constexpr int AnalyzerOctaveNumber{ 10 };
+    constexpr uint64_t AnalyzerFrameSlots{ 512 }; // power of two
+    constexpr uint32_t AnalyzerLeases{ 2 * AnalyzerFrameSlots };
+
+    // bounded queue of slot indices after Vyukov, never holds more than AnalyzerFrameSlots entries
+    class SlotQueue
+    {
+    public:
+        void reset()
+        {
+            for (uint64_t i = 0; i < AnalyzerFrameSlots; i++)
+            {
+                mCells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+            mEnqueuePosition.store(0);
+            mDequeuePosition.store(0);
+        }
+
+        bool push(const uint32_t slot)
+        {
+            uint64_t position = mEnqueuePosition.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                Cell& cell = mCells[position & (AnalyzerFrameSlots - 1)];
+                const uint64_t sequence = cell.sequence.load(std::memory_order_acquire);
+                const int64_t difference = static_cast<int64_t>(sequence) - static_cast<int64_t>(position);
+                if (difference == 0)
+                {
+                    if (mEnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        cell.slot = slot;
+                        cell.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    position = mEnqueuePosition.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool pop(uint32_t& slot)
+        {
+            uint64_t position = mDequeuePosition.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                Cell& cell = mCells[position & (AnalyzerFrameSlots - 1)];
+                const uint64_t sequence = cell.sequence.load(std::memory_order_acquire);
+                const int64_t difference = static_cast<int64_t>(sequence) - static_cast<int64_t>(position + 1);
+                if (difference == 0)
+                {
+                    if (mDequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        slot = cell.slot;
+                        cell.sequence.store(position + AnalyzerFrameSlots, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    position = mDequeuePosition.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+    private:
+        struct Cell
+        {
+            std::atomic<uint64_t> sequence{ 0 };
+            uint32_t slot{ 0 };
+        };
+
+        std::unique_ptr<Cell[]> mCells{ new Cell[AnalyzerFrameSlots] };
+        alignas(64) std::atomic<uint64_t> mEnqueuePosition{ 0 };
+        alignas(64) std::atomic<uint64_t> mDequeuePosition{ 0 };
+    };
+}
+
+struct cqt_analyzer
+{
+    bool realtime{ false };
+    int maxBlockSize{ 0 };
+
+    struct Lease
+    {
+        uint64_t epoch{ 0 };
+        uint32_t slot{ 0 };
+        bool leased{ false };
+    };
+
+    // filled by the octave threads, copied into the lease's descriptor by poll
+    std::unique_ptr<cqt_frame[]> slotFrames{ new cqt_frame[AnalyzerFrameSlots] };
+    std::unique_ptr<double[]> magnitudes{ new double[AnalyzerFrameSlots * AnalyzerBinsPerOctave] };
+    std::unique_ptr<double[]> frequencies{ new double[AnalyzerFrameSlots * AnalyzerBinsPerOctave] };
+    // consumer side only, room for a full ring of leases plus as many held across prepare
+    std::unique_ptr<cqt_frame[]> frames{ new cqt_frame[AnalyzerLeases] };
+    std::unique_ptr<Lease[]> leases{ new Lease[AnalyzerLeases] };
+    std::unique_ptr<uint32_t[]> freeLeases{ new uint32_t[AnalyzerLeases] };
+    uint32_t numFreeLeases{ 0 };
+    SlotQueue freeSlots;
+    SlotQueue readySlots;
+    std::atomic<uint64_t> epoch{ 0 };
+    std::atomic<uint64_t> droppedFrames{ 0 };
+    std::atomic<bool> accepting{ false };
+
+    // last, so its clock threads are gone before the ring is destroyed
+    CqtEngine<AnalyzerBinsPerOctave, AnalyzerOctaveNumber> engine;
+
+    // only while no frames are produced, leases still held stay out of the pool until released
+    void resetRing()
+    {
+        epoch.store(epoch.load() + 1);
+        freeSlots.reset();
+        readySlots.reset();
+        for (uint32_t i = 0; i < AnalyzerFrameSlots; i++)
+        {
+            slotFrames[i].magnitudes = &magnitudes[i * AnalyzerBinsPerOctave];
+            slotFrames[i].frequencies = &frequencies[i * AnalyzerBinsPerOctave];
+            slotFrames[i].num_bins = AnalyzerBinsPerOctave;
+            freeSlots.push(i);
+        }
+        numFreeLeases = 0;
+        for (uint32_t i = 0; i < AnalyzerLeases; i++)
+        {
+            if (!leases[i].leased)
+                freeLeases[numFreeLeases++] = i;
+        }
+    }
+
+    void enqueue(const int octave, const uint64_t samplePosition, const double* frameMagnitudes)
+    {
+        if (!accepting.load())
+            return;
+        uint32_t slot = 0;
+        if (!freeSlots.pop(slot))
+        {
+            // every slot is unread or leased
+            droppedFrames.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        cqt_frame* frame = &slotFrames[slot];
+        frame->sample_position = samplePosition;
+        frame->centre_position = samplePosition - std::min(samplePosition, engine.getWindowCentreOffset(octave));
+        frame->octave = static_cast<uint32_t>(octave);
+        std::copy(frameMagnitudes, frameMagnitudes + AnalyzerBinsPerOctave, &magnitudes[slot * AnalyzerBinsPerOctave]);
+        // the listener runs right after the octave's frequencies were measured, on the same thread
+        const double* frameFrequencies = engine.mInstantaneousFreqs[octave];
+        std::copy(frameFrequencies, frameFrequencies + AnalyzerBinsPerOctave, &frequencies[slot * AnalyzerBinsPerOctave]);
+        readySlots.push(slot);
+    }
+};
+
+extern "C"
+{
+
+uint32_t cqt_analyzer_abi_version(void)
+{
+    return CQT_ANALYZER_ABI_VERSION;
+}
+
+uint32_t cqt_analyzer_bins_per_octave(void)
+{
+    return AnalyzerBinsPerOctave;
+}
+
+uint32_t cqt_analyzer_octaves(void)
+{
+    return AnalyzerOctaveNumber;
+}
+
+cqt_analyzer* cqt_analyzer_create(uint32_t flags)
+{
+    auto* analyzer = new (std::nothrow) cqt_analyzer();
+    if (analyzer == nullptr)
+        return nullptr;
+    analyzer->realtime = (flags & CQT_ANALYZER_REALTIME) != 0;
+    analyzer->engine.setVirtualClock(!analyzer->realtime);
+    analyzer->engine.setInstantaneousFrequency((flags & CQT_ANALYZER_INSTANTANEOUS_FREQUENCY) != 0);
+    analyzer->engine.setFrameListener([analyzer](const int octave, const uint64_t samplePosition, const double* frameMagnitudes)
+    {
+        analyzer->enqueue(octave, samplePosition, frameMagnitudes);
+    });
+    analyzer->resetRing();
+    return analyzer;
+}
+
+void cqt_analyzer_destroy(cqt_analyzer* analyzer)
+{
+    delete analyzer;
+}
+
+int cqt_analyzer_prepare(cqt_analyzer* analyzer, double sample_rate, int max_block_size)
+{
+    if (analyzer == nullptr || sample_rate <= 0. || max_block_size <= 0)
+        return -1;
+    // prepare waits for running octave calls, the ones after it drop their frames until the ring is reset
+    analyzer->accepting.store(false);
+    analyzer->engine.prepare(sample_rate, max_block_size);
+    analyzer->maxBlockSize = max_block_size;
+    analyzer->resetRing();
+    analyzer->droppedFrames.store(0);
+    analyzer->accepting.store(true);
+    return 0;
+}
+
+int cqt_analyzer_set_tuning(cqt_analyzer* analyzer, double tuning)
+{
+    if (analyzer == nullptr || tuning <= 0.)
+        return -1;
+    analyzer->engine.setTuning(tuning);
+    return 0;
+}
+
+int cqt_analyzer_set_frequency_range(cqt_analyzer* analyzer, double min_frequency, double max_frequency)
+{
+    if (analyzer == nullptr || min_frequency > max_frequency)
+        return -1;
+    analyzer->engine.setFrequencyRange(min_frequency, max_frequency);
+    return 0;
+}
+
+int cqt_analyzer_push(cqt_analyzer* analyzer, const float* samples, int num_samples)
+{
+    if (analyzer == nullptr || analyzer->maxBlockSize == 0 || (samples == nullptr && num_samples > 0))
+        return -1;
+    for (int offset = 0; offset < num_samples; offset += analyzer->maxBlockSize)
+    {
+        const int blockSize = std::min(analyzer->maxBlockSize, num_samples - offset);
+        double* input = analyzer->engine.getInputBuffer();
+        for (int s = 0; s < blockSize; s++)
+        {
+            input[s] = static_cast<double>(samples[offset + s]);
+        }
+        analyzer->engine.processInput(blockSize);
+        if (!analyzer->realtime)
+            analyzer->engine.advanceVirtualClock();
+    }
+    return 0;
+}
+
+const cqt_frame* cqt_analyzer_poll(cqt_analyzer* analyzer)
+{
+    if (analyzer == nullptr)
+        return nullptr;
+    uint32_t slot = 0;
+    if (!analyzer->readySlots.pop(slot))
+        return nullptr;
+    if (analyzer->numFreeLeases == 0)
+    {
+        // only when the caller keeps more frames from before prepare than the ring holds
+        analyzer->freeSlots.push(slot);
+        analyzer->droppedFrames.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    const uint32_t index = analyzer->freeLeases[--analyzer->numFreeLeases];
+    auto& lease = analyzer->leases[index];
+    lease.epoch = analyzer->epoch.load(std::memory_order_relaxed);
+    lease.slot = slot;
+    lease.leased = true;
+    analyzer->frames[index] = analyzer->slotFrames[slot];
+    return &analyzer->frames[index];
+}
+
+void cqt_analyzer_release(cqt_analyzer* analyzer, const cqt_frame* frame)
+{
+    if (analyzer == nullptr || frame == nullptr)
+        return;
+    const auto index = static_cast<uint64_t>(frame - analyzer->frames.get());
+    if (index >= AnalyzerLeases || !analyzer->leases[index].leased)
+        return;
+    auto& lease = analyzer->leases[index];
+    lease.leased = false;
+    analyzer->freeLeases[analyzer->numFreeLeases++] = static_cast<uint32_t>(index);
+    // slots of leases from before the last prepare were already returned by it
+    if (lease.epoch == analyzer->epoch.load(std::memory_order_relaxed))
+        analyzer->freeSlots.push(lease.slot);
+}
+
+uint64_t cqt_analyzer_dropped_frames(const cqt_analyzer* analyzer)
+{
+    return analyzer != nullptr ? analyzer->droppedFrames.load() : 0;
+}
+
+const double* cqt_analyzer_kernel_frequencies(const cqt_analyzer* analyzer)
+{
+    return analyzer != nullptr ? &analyzer->engine.mKernelFreqs[0][0] : nullptr;
+}
+
+}
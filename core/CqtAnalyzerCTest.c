@@ -0,0 +1,149 @@
+/*
+Checks the frame ring of libcqtanalyzer: releasing a frame polled before prepare must neither stall
+the analyzer nor free a frame polled since, and a frame that is held on to must not keep the other
+slots from being reused.
+Runs offline, returns non-zero on failure.
+*/
+
+#include "cqtanalyzer.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#define TEST_SAMPLE_RATE 48000.
+#define TEST_BLOCK_SIZE 256
+#define TEST_SECONDS 4
+
+static float testSignal[48000];
+
+static int pushSecond(cqt_analyzer* analyzer)
+{
+    return cqt_analyzer_push(analyzer, testSignal, 48000);
+}
+
+static int releaseAfterPrepare(void)
+{
+    cqt_analyzer* analyzer = cqt_analyzer_create(0);
+    if (analyzer == NULL || cqt_analyzer_prepare(analyzer, TEST_SAMPLE_RATE, TEST_BLOCK_SIZE) != 0)
+        return 1;
+    pushSecond(analyzer);
+    const cqt_frame* stale = cqt_analyzer_poll(analyzer);
+    if (stale == NULL)
+    {
+        printf("releaseAfterPrepare: no frame before prepare\n");
+        return 1;
+    }
+    cqt_analyzer_prepare(analyzer, TEST_SAMPLE_RATE, TEST_BLOCK_SIZE);
+    cqt_analyzer_release(analyzer, stale);
+    cqt_analyzer_release(analyzer, stale);
+
+    /* used to hang here */
+    int frames = 0;
+    for (int second = 0; second < TEST_SECONDS; second++)
+    {
+        pushSecond(analyzer);
+        const cqt_frame* frame;
+        while ((frame = cqt_analyzer_poll(analyzer)) != NULL)
+        {
+            cqt_analyzer_release(analyzer, frame);
+            frames++;
+        }
+    }
+    const uint64_t dropped = cqt_analyzer_dropped_frames(analyzer);
+    cqt_analyzer_destroy(analyzer);
+    if (frames == 0 || dropped != 0)
+    {
+        printf("releaseAfterPrepare: %d frames, %llu dropped\n", frames, (unsigned long long)dropped);
+        return 1;
+    }
+    return 0;
+}
+
+static int releaseAfterTwoPrepares(void)
+{
+    cqt_analyzer* analyzer = cqt_analyzer_create(0);
+    if (analyzer == NULL || cqt_analyzer_prepare(analyzer, TEST_SAMPLE_RATE, TEST_BLOCK_SIZE) != 0)
+        return 1;
+    pushSecond(analyzer);
+    const cqt_frame* stale = cqt_analyzer_poll(analyzer);
+    cqt_analyzer_prepare(analyzer, TEST_SAMPLE_RATE, TEST_BLOCK_SIZE);
+    cqt_analyzer_prepare(analyzer, TEST_SAMPLE_RATE, TEST_BLOCK_SIZE);
+    pushSecond(analyzer);
+    const cqt_frame* held = cqt_analyzer_poll(analyzer);
+    if (stale == NULL || held == NULL)
+    {
+        printf("releaseAfterTwoPrepares: no frame\n");
+        return 1;
+    }
+    const uint64_t heldPosition = held->sample_position;
+    const double heldMagnitude = held->magnitudes[0];
+
+    /* must not free the slot of the frame held in the current epoch */
+    cqt_analyzer_release(analyzer, stale);
+    for (int second = 0; second < TEST_SECONDS; second++)
+    {
+        pushSecond(analyzer);
+        const cqt_frame* frame;
+        while ((frame = cqt_analyzer_poll(analyzer)) != NULL)
+        {
+            cqt_analyzer_release(analyzer, frame);
+        }
+    }
+    const int untouched = held->sample_position == heldPosition && held->magnitudes[0] == heldMagnitude;
+    cqt_analyzer_release(analyzer, held);
+    cqt_analyzer_destroy(analyzer);
+    if (!untouched)
+    {
+        printf("releaseAfterTwoPrepares: held frame overwritten\n");
+        return 1;
+    }
+    return 0;
+}
+
+static int holdOneFrame(void)
+{
+    cqt_analyzer* analyzer = cqt_analyzer_create(0);
+    if (analyzer == NULL || cqt_analyzer_prepare(analyzer, TEST_SAMPLE_RATE, TEST_BLOCK_SIZE) != 0)
+        return 1;
+    const cqt_frame* held = NULL;
+    uint64_t heldPosition = 0;
+    int frames = 0;
+    for (int second = 0; second < TEST_SECONDS; second++)
+    {
+        pushSecond(analyzer);
+        const cqt_frame* frame;
+        while ((frame = cqt_analyzer_poll(analyzer)) != NULL)
+        {
+            frames++;
+            if (held == NULL)
+            {
+                held = frame;
+                heldPosition = frame->sample_position;
+                continue;
+            }
+            cqt_analyzer_release(analyzer, frame);
+        }
+    }
+    const uint64_t dropped = cqt_analyzer_dropped_frames(analyzer);
+    const int untouched = held != NULL && held->sample_position == heldPosition;
+    cqt_analyzer_release(analyzer, held);
+    cqt_analyzer_destroy(analyzer);
+    if (frames < 2 || dropped != 0 || !untouched)
+    {
+        printf("holdOneFrame: %d frames, %llu dropped, held frame %s\n", frames, (unsigned long long)dropped,
+            untouched ? "untouched" : "overwritten");
+        return 1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    for (int s = 0; s < 48000; s++)
+    {
+        testSignal[s] = 0.5f * sinf(2.f * 3.14159265f * 440.f * (float)s / 48000.f);
+    }
+    const int failures = releaseAfterPrepare() + releaseAfterTwoPrepares() + holdOneFrame();
+    printf("%s\n", failures == 0 ? "passed" : "FAILED");
+    return failures;
+}
@@ -0,0 +1,7 @@
+// Instantiates the engine for the configurations the plugins use, so the library compiles every
+// member once and the engine is checked to build without any framework headers.
+
+#include "../include/CqtEngine.h"
+
+template class CqtEngine<48, 10>;   // JUCE plugin
+template class CqtEngine<12, 9>;    // iPlug plugin
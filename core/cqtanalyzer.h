@@ -0,0 +1,81 @@
+/*
+C interface of libcqtanalyzer, the CqtAnalyzer plugin's analysis for embedding through FFI.
+
+Frames are handed out as pointers into ring slots owned by the analyzer. A polled frame stays valid
+and untouched until it is released, its slot is only reused afterwards. Frames may be released in
+any order, a held frame only occupies its own slot. When all slots are taken, new frames are dropped
+and counted. prepare drops all unreleased frames, releasing one of them afterwards is ignored.
+
+Without CQT_ANALYZER_REALTIME the analysis is deterministic: every push computes the octave frames
+that became due on the calling thread, so the same input always yields the same frames. With it,
+frames are computed on background threads at the plugin's update rates.
+
+poll and release must be called from one thread at a time, push from one thread at a time.
+Functions returning int return 0 on success and a negative value on failure.
+*/
+#ifndef CQTANALYZER_H
+#define CQTANALYZER_H
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#if defined(CQT_ANALYZER_BUILD)
+#define CQT_ANALYZER_API __declspec(dllexport)
+#else
+#define CQT_ANALYZER_API __declspec(dllimport)
+#endif
+#else
+#define CQT_ANALYZER_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CQT_ANALYZER_ABI_VERSION 3
+
+/* flags for cqt_analyzer_create */
+#define CQT_ANALYZER_REALTIME 1
+#define CQT_ANALYZER_INSTANTANEOUS_FREQUENCY 2 /* measure the bin frequencies from the phase advance */
+
+typedef struct cqt_analyzer cqt_analyzer;
+
+typedef struct cqt_frame
+{
+    uint64_t sample_position;   /* input samples pushed when the frame was computed */
+    uint32_t octave;            /* 0 is the highest octave */
+    uint32_t num_bins;          /* bins per octave */
+    const double* magnitudes;   /* num_bins magnitudes, lowest bin first */
+    const double* frequencies;  /* num_bins measured bin frequencies in Hz, the kernel frequencies if not measured */
+    uint64_t centre_position;   /* input sample the octave's analysis window is centred on */
+} cqt_frame;
+
+CQT_ANALYZER_API uint32_t cqt_analyzer_abi_version(void);
+CQT_ANALYZER_API uint32_t cqt_analyzer_bins_per_octave(void);
+CQT_ANALYZER_API uint32_t cqt_analyzer_octaves(void);
+
+CQT_ANALYZER_API cqt_analyzer* cqt_analyzer_create(uint32_t flags);
+CQT_ANALYZER_API void cqt_analyzer_destroy(cqt_analyzer* analyzer);
+
+/* (re)starts the analysis, drops all unreleased frames */
+CQT_ANALYZER_API int cqt_analyzer_prepare(cqt_analyzer* analyzer, double sample_rate, int max_block_size);
+CQT_ANALYZER_API int cqt_analyzer_set_tuning(cqt_analyzer* analyzer, double tuning);
+/* octaves entirely outside [min_frequency, max_frequency] produce no frames, applied by the next prepare */
+CQT_ANALYZER_API int cqt_analyzer_set_frequency_range(cqt_analyzer* analyzer, double min_frequency, double max_frequency);
+
+/* mono input of any length */
+CQT_ANALYZER_API int cqt_analyzer_push(cqt_analyzer* analyzer, const float* samples, int num_samples);
+
+/* oldest unread frame or NULL, the frame belongs to the caller until released */
+CQT_ANALYZER_API const cqt_frame* cqt_analyzer_poll(cqt_analyzer* analyzer);
+CQT_ANALYZER_API void cqt_analyzer_release(cqt_analyzer* analyzer, const cqt_frame* frame);
+CQT_ANALYZER_API uint64_t cqt_analyzer_dropped_frames(const cqt_analyzer* analyzer);
+
+/* center frequencies, octaves * bins_per_octave values laid out like the frames */
+CQT_ANALYZER_API const double* cqt_analyzer_kernel_frequencies(const cqt_analyzer* analyzer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+/*
+Attack and release of the displayed magnitudes, given as time constants in milliseconds.
+Each octave is smoothed when it produces a frame, with coefficients derived from the input samples
+that elapsed since its previous frame. The result thus depends only on the audio, neither on the
+octave's update interval nor on the display rate or the load of the machine.
+The per-bin select between attack and release is branch free, so a frame is one vectorized pass.
+Each octave has its own state, so the octave threads may call process() concurrently for different octaves.
+*/
+template <int B, int OctaveNumber>
+class Ballistics
+{
+public:
+    void setTimes(const double attackMs, const double releaseMs)
+    {
+        mAttackMs.store(std::max(0., attackMs));
+        mReleaseMs.store(std::max(0., releaseMs));
+    }
+
+    void reset()
+    {
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            mPreviousPosition[o] = 0;
+        }
+    }
+
+    // smoothed follows magnitudes, samplePosition counts input samples at sampleRate
+    void process(const int octave, const double* magnitudes, const uint64_t samplePosition, const double sampleRate, double* smoothed)
+    {
+        const double elapsedMs = static_cast<double>(samplePosition - mPreviousPosition[octave]) * 1000. / sampleRate;
+        mPreviousPosition[octave] = samplePosition;
+        const double attack = coefficient(elapsedMs, mAttackMs.load(std::memory_order_relaxed));
+        const double release = coefficient(elapsedMs, mReleaseMs.load(std::memory_order_relaxed));
+        for (int tone = 0; tone < B; tone++)
+        {
+            const double value = magnitudes[tone];
+            const double c = value > smoothed[tone] ? attack : release;
+            smoothed[tone] = value + c * (smoothed[tone] - value);
+        }
+    }
+
+private:
+    static double coefficient(const double elapsedMs, const double timeConstantMs)
+    {
+        return timeConstantMs > 0. ? std::exp(-elapsedMs / timeConstantMs) : 0.;
+    }
+
+    uint64_t mPreviousPosition[OctaveNumber] = {};
+    std::atomic<double> mAttackMs{ 40. };
+    std::atomic<double> mReleaseMs{ 150. };
+};
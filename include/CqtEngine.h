@@ -0,0 +1,754 @@
+#pragma once
+
+#include "SharedResources.h"
+#include "HistoryStore.h"
+#include "SharedMemoryPublisher.h"
+#include "FeatureExtractor.h"
+#include "PitchTracker.h"
+#include "OnsetDetector.h"
+#include "KeyChordEstimator.h"
+#include "LoadGovernor.h"
+#include "EngineArena.h"
+#include "InstantaneousFrequency.h"
+#include "FrameTimeline.h"
+#include "LatestFrames.h"
+#include "Ballistics.h"
+#include "PreDecimator.h"
+#include "FrameAligner.h"
+#include "SpectralSnapshots.h"
+#include "../submodules/rt-cqt/include/ConstantQTransform.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+constexpr size_t HistoryUpdateRate{ 50 };
+constexpr double HistoryLengthHours{ 3. };
+constexpr int HistoryLevels{ 6 };
+constexpr double HistoryResidentSeconds{ 30. };
+constexpr size_t GovernorUpdateRate{ 500 };
+constexpr int EngineMaxOverlap{ 8 };
+constexpr int EngineMaxRateDivisor{ 4 };
+constexpr double GateSilenceThreshold{ 1e-10 }; // mean square, -100 dBFS
+
+/*
+The analysis without any framework around it: the cqt, its scheduling on the shared clocks or a
+virtual clock, magnitudes, features, history and frame publishing.
+The host feeds blocks through getInputBuffer() and processInput() on the audio thread, everything
+else runs on the clock threads. prepare() must not run concurrently with processInput().
+*/
+template <int B, int OctaveNumber>
+class CqtEngine
+{
+public:
+    using FrameListener = std::function<void(const int octave, const uint64_t samplePosition, const double* magnitudes)>;
+
+    CqtEngine()
+    {
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            mOctaveOverlap[o].store(1);
+            mOctaveRateDivisor[o].store(1);
+            mOctaveActive[o].store(true);
+            mZeroFramePublished[o].store(false);
+            mOctaveIntervalMs[o] = 0.;
+            for (int tone = 0; tone < B; tone++)
+            {
+                mCqtDataStorage[o][tone] = 0.;
+                mSmoothedMagnitudes[o][tone] = 0.;
+                mKernelFreqs[o][tone] = 0.;
+                mInstantaneousFreqs[o][tone] = 0.;
+            }
+        }
+    }
+
+    ~CqtEngine()
+    {
+        detachClocks();
+    }
+
+    CqtEngine(const CqtEngine&) = delete;
+    CqtEngine& operator=(const CqtEngine&) = delete;
+
+    // history spills into a memory-mapped file at path
+    bool openHistory(const std::string& path)
+    {
+        const double historyFrameRate = 1000. / static_cast<double>(HistoryUpdateRate);
+        return mHistory.open(path,
+            static_cast<size_t>(HistoryLengthHours * 3600. * historyFrameRate),
+            HistoryLevels,
+            static_cast<size_t>(HistoryResidentSeconds * historyFrameRate));
+    }
+
+    // every completed octave frame is published to the shared-memory ring name
+    bool openPublisher(const std::string& name)
+    {
+        return mFramePublisher.open(name, mSampleRate);
+    }
+
+    void prepare(const double sampleRate, const int maxBlockSize)
+    {
+        // no octave call may run while the engine is re-initialized
+        std::lock_guard<std::mutex> lock(mClockMutex);
+        detachClocks();
+        mSampleRate = sampleRate;
+
+        // initialize the cqt, the overlap divides the default hop of each octave
+        std::vector<int> hopSizes(OctaveNumber);
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            hopSizes[o] = std::max(1, static_cast<int>(Cqt::Fft_Size / std::pow(2, o)) / getOctaveOverlap(o));
+        }
+        mCqt.init(hopSizes);
+        // above 50 kHz the input is halved first, so the octaves start near the audible band
+        const int preDecimationStages = PreDecimator::getStagesFor(sampleRate);
+        mPreDecimator.prepare(preDecimationStages);
+        mCqt.initFs(sampleRate / static_cast<double>(mPreDecimator.getFactor()), maxBlockSize);
+        mArena.prepare(maxBlockSize);
+        mSamplePosition.store(0);
+        mFramePublisher.setSampleRate(sampleRate);
+        mFeatures.reset();
+        mOnsetDetector.reset();
+        mKeyChordEstimator.reset();
+        mInstantaneousFrequency.reset();
+        mFrameTimeline.reset();
+        mBallistics.reset();
+        mSnapshots.reset();
+        mLatestMagnitudes.reset();
+        mLatestFrequencies.reset();
+
+        // reset feature buffers
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            for (int tone = 0; tone < B; tone++)
+            {
+                mCqtDataStorage[o][tone] = 0.;
+                mSmoothedMagnitudes[o][tone] = 0.;
+                mKernelFreqs[o][tone] = 0.;
+            }
+        }
+
+        // octaves entirely outside the frequency range are never scheduled
+        const auto kernelFreqs = mCqt.getKernelFreqs();
+        const double minFrequency = mMinFrequency.load();
+        const double maxFrequency = mMaxFrequency.load();
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            mOctaveActive[o].store(kernelFreqs[o][B - 1] >= minFrequency && kernelFreqs[o][0] <= maxFrequency);
+        }
+
+        // the gate closes once the longest active kernel has seen nothing but silence
+        int longestOctave = 0;
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            if (mOctaveActive[o].load())
+                longestOctave = o;
+        }
+        mGateHoldSamples = static_cast<uint64_t>(Cqt::Fft_Size) << (longestOctave + preDecimationStages);
+        mSilentSamples = 0;
+        openGate();
+
+        // with the virtual clock the same intervals are counted in samples instead of attaching to the shared clocks
+        for (int i = 0; i < OctaveNumber; i++)
+        {
+            mOctaveIntervalMs[i] = mCqt.getLatencyMs(i) * static_cast<double>(getOctaveRateDivisor(i));
+            const auto interval = std::max<size_t>(1, static_cast<size_t>(mOctaveIntervalMs[i]));
+            mOctaveIntervalSamples[i] = std::max<uint64_t>(1, static_cast<uint64_t>(interval * sampleRate / 1000.));
+            mOctaveNextDueSample[i] = mOctaveIntervalSamples[i];
+        }
+        // The window of octave o spans Fft_Size samples at its decimated rate and ends at the newest input.
+        // The time-aligned view trails the input by the centre offset plus one interval of the octave
+        // centred furthest back, every other octave is delayed to that instant through its ring.
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            mWindowCentreOffset[o] = static_cast<uint64_t>(Cqt::Fft_Size / 2) << (o + preDecimationStages);
+        }
+        mAlignedDelaySamples = mWindowCentreOffset[longestOctave] + mOctaveIntervalSamples[longestOctave];
+        int alignerFrames[OctaveNumber];
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            const uint64_t delay = mAlignedDelaySamples - std::min(mAlignedDelaySamples, mWindowCentreOffset[o]);
+            alignerFrames[o] = mOctaveActive[o].load() ? static_cast<int>(std::min<uint64_t>(FrameAlignerMaxFrames, delay / mOctaveIntervalSamples[o] + 2)) : 2;
+        }
+        {
+            std::lock_guard<std::mutex> alignerLock(mAlignerMutex);
+            mFrameAligner.prepare(alignerFrames);
+        }
+
+        mHistoryIntervalSamples = std::max<uint64_t>(1, static_cast<uint64_t>(HistoryUpdateRate * sampleRate / 1000.));
+        mHistoryNextDueSample = mHistoryIntervalSamples;
+        // the octave threads read the kernel frequencies, they are in place before the first call
+        updateKernelFreqs();
+        if (!mSuspended.load())
+            attachAnalysisClocks();
+
+        // wall clock load measurement makes no sense with the virtual clock, stay at full quality there
+        mGovernor.reset();
+        if (!mVirtualClock)
+            mGovernorClock.attach(std::chrono::milliseconds(GovernorUpdateRate), std::bind(&CqtEngine::updateGovernor, this));
+    }
+
+    // buffer for the next block, holds maxBlockSize samples
+    double* getInputBuffer()
+    {
+        return mArena.getInput();
+    }
+
+    // hands the first numSamples of the input buffer to the cqt, audio thread only
+    void processInput(const int numSamples)
+    {
+        // silence gate on the block's energy, opens again with the first block above the threshold
+        const double* input = mArena.getInput();
+        double energy = 0.;
+        for (int s = 0; s < numSamples; s++)
+        {
+            energy += input[s] * input[s];
+        }
+        if (energy > GateSilenceThreshold * static_cast<double>(numSamples))
+        {
+            mSilentSamples = 0;
+            if (mGated.load(std::memory_order_relaxed))
+                openGate();
+        }
+        else
+        {
+            mSilentSamples += static_cast<uint64_t>(numSamples);
+            if (mSilentSamples > mGateHoldSamples && !mGated.load(std::memory_order_relaxed))
+                mGated.store(true, std::memory_order_release);
+        }
+
+        const int numDecimated = mPreDecimator.process(mArena.getInput(), numSamples);
+        if (numDecimated > 0)
+            mCqt.inputBlock(mArena.getInput(), numDecimated);
+        mSamplePosition.fetch_add(static_cast<uint64_t>(numSamples), std::memory_order_relaxed);
+        mThreadPolicy.noteAudioThread();
+    }
+
+    // message thread, the kernels are swapped while no octave call runs
+    void setTuning(const double tuning)
+    {
+        // excludes prepare() as well
+        std::lock_guard<std::mutex> clockLock(mClockMutex);
+        std::unique_lock<std::shared_mutex> lock(mKernelMutex);
+        mTuning.store(tuning);
+        mCqt.setConcertPitch(tuning);
+        updateKernelFreqs();
+    }
+
+    // overlap 1, 2, 4 or 8 of the octave's hop relative to the default hop, applied by the next prepare()
+    void setOctaveOverlap(const int octave, const int overlap)
+    {
+        int rounded = 1;
+        while (rounded < EngineMaxOverlap && rounded < overlap)
+        {
+            rounded *= 2;
+        }
+        mOctaveOverlap[octave].store(rounded);
+    }
+
+    int getOctaveOverlap(const int octave) const
+    {
+        return mOctaveOverlap[octave].load();
+    }
+
+    // Divisor 1, 2 or 4 of the octave's update rate, applied by the next prepare(). The hop stays, the
+    // octave's clock interval is stretched instead, so each transform still sees its newest input.
+    void setOctaveRateDivisor(const int octave, const int divisor)
+    {
+        int rounded = 1;
+        while (rounded < EngineMaxRateDivisor && rounded < divisor)
+        {
+            rounded *= 2;
+        }
+        mOctaveRateDivisor[octave].store(rounded);
+    }
+
+    int getOctaveRateDivisor(const int octave) const
+    {
+        return mOctaveRateDivisor[octave].load();
+    }
+
+    double getOctaveUpdateIntervalMs(const int octave) const
+    {
+        return mOctaveIntervalMs[octave];
+    }
+
+    // Octaves whose bins all lie outside [minFrequency, maxFrequency] are neither scheduled nor published,
+    // applied by the next prepare()
+    void setFrequencyRange(const double minFrequency, const double maxFrequency)
+    {
+        mMinFrequency.store(minFrequency);
+        mMaxFrequency.store(maxFrequency);
+    }
+
+    bool isOctaveActive(const int octave) const
+    {
+        return mOctaveActive[octave].load();
+    }
+
+    /*
+    Suspends the periodic analysis while nobody consumes it. The input keeps flowing into the cqt's
+    buffers, so after resuming the first call of every octave already sees the recent audio.
+    Message thread, has no effect with the virtual clock.
+    */
+    void setSuspended(const bool suspended)
+    {
+        std::lock_guard<std::mutex> lock(mClockMutex);
+        if (suspended == mSuspended.load())
+            return;
+        mSuspended.store(suspended);
+        if (mSampleRate <= 0.)
+            return;
+        if (suspended)
+        {
+            detachAnalysisClocks();
+        }
+        else
+        {
+            // the smoothing and phase state are as stale as the pause is long
+            mBallistics.reset();
+            mInstantaneousFrequency.reset();
+            attachAnalysisClocks();
+        }
+    }
+
+    bool isSuspended() const
+    {
+        return mSuspended.load();
+    }
+
+    // a reader of the shared-memory ring signalled within maxAge
+    bool hasSharedMemoryReader(const std::chrono::milliseconds maxAge) const
+    {
+        return mFramePublisher.hasReader(maxAge);
+    }
+
+    // true while the input is silent and the transforms are paused
+    bool isGated() const
+    {
+        return mGated.load();
+    }
+
+    // 1, or the factor the input is decimated by ahead of the cqt at high sample rates
+    int getPreDecimationFactor() const
+    {
+        return mPreDecimator.getFactor();
+    }
+
+    void setCpuBudget(const double budget)
+    {
+        mGovernor.setBudget(budget);
+    }
+
+    // attack and release time constants of mSmoothedMagnitudes
+    void setBallistics(const double attackMs, const double releaseMs)
+    {
+        mBallistics.setTimes(attackMs, releaseMs);
+    }
+
+    // Phase-based refinement of the bin frequencies into mInstantaneousFreqs, off by default. Disabled,
+    // the array holds the kernel frequencies. Only bins whose kernel is longer than twice the hop are
+    // refined, see InstantaneousFrequency.
+    void setInstantaneousFrequency(const bool enabled)
+    {
+        if (enabled == mRefineFrequencies.load())
+            return;
+        // the octave threads fall back to the kernel frequencies themselves
+        mInstantaneousFrequency.reset();
+        mRefineFrequencies.store(enabled);
+    }
+
+    bool isInstantaneousFrequencyEnabled() const
+    {
+        return mRefineFrequencies.load();
+    }
+
+    bool readHistory(const double secondsAgo, const int level, double frame[OctaveNumber][B]) const
+    {
+        const double framePeriod = static_cast<double>(HistoryUpdateRate) * 0.001 * std::pow(HistoryPyramidFactor, level);
+        const auto framesAgo = static_cast<size_t>(std::max(0., secondsAgo) / framePeriod);
+        return mHistory.read(level, framesAgo, frame);
+    }
+
+    double getHistoryLengthSeconds(const int level) const
+    {
+        const double framePeriod = static_cast<double>(HistoryUpdateRate) * 0.001 * std::pow(HistoryPyramidFactor, level);
+        return static_cast<double>(mHistory.getNumFrames(level)) * framePeriod;
+    }
+
+    int getHistoryLevels() const
+    {
+        return mHistory.getNumLevels();
+    }
+
+    // newest unsmoothed magnitudes and measured bin frequencies of every octave, for any thread
+    void readMagnitudes(double frame[OctaveNumber][B]) const
+    {
+        mLatestMagnitudes.read(frame);
+    }
+
+    void readInstantaneousFreqs(double frame[OctaveNumber][B]) const
+    {
+        mLatestFrequencies.read(frame);
+    }
+
+    // live smoothed magnitudes interpolated to displayTime, see FrameTimeline
+    void readInterpolated(const std::chrono::steady_clock::time_point displayTime, double frame[OctaveNumber][B]) const
+    {
+        mFrameTimeline.interpolate(displayTime, frame);
+    }
+
+    // completion time of the octave's newest frame
+    std::chrono::steady_clock::time_point getFrameTime(const int octave) const
+    {
+        return mFrameTimeline.getFrameTime(octave);
+    }
+
+    const std::string& getSharedMemoryName() const
+    {
+        return mFramePublisher.getName();
+    }
+
+    // input samples between the newest sample an octave frame saw and the centre of its window
+    uint64_t getWindowCentreOffset(const int octave) const
+    {
+        return mWindowCentreOffset[octave];
+    }
+
+    // live smoothed magnitudes with every octave showing the same instant, see FrameAligner
+    void readAligned(double frame[OctaveNumber][B]) const
+    {
+        // the rings are reallocated by prepare(), which may run on the host's thread
+        std::unique_lock<std::mutex> alignerLock(mAlignerMutex, std::try_to_lock);
+        if (!alignerLock.owns_lock())
+            return;
+        const uint64_t samplePosition = mSamplePosition.load(std::memory_order_relaxed);
+        const double centre = static_cast<double>(samplePosition) - static_cast<double>(mAlignedDelaySamples);
+        mFrameAligner.read(std::max(0., centre), frame);
+    }
+
+    // how far the time-aligned view trails the input
+    double getAlignedLatencyMs() const
+    {
+        return mSampleRate > 0. ? static_cast<double>(mAlignedDelaySamples) * 1000. / mSampleRate : 0.;
+    }
+
+    size_t getArenaBytes() const
+    {
+        return mArena.getBytes();
+    }
+
+    uint64_t getSamplePosition() const
+    {
+        return mSamplePosition.load(std::memory_order_relaxed);
+    }
+
+    const FeatureExtractor<B, OctaveNumber>& getFeatures() const { return mFeatures; }
+    std::array<PitchEstimate, PitchMaxVoices> getPitchEstimates() const { return mPitchTracker.getEstimates(); }
+    const OnsetDetector<B, OctaveNumber>& getOnsets() const { return mOnsetDetector; }
+    const SpectralSnapshots<B, OctaveNumber>& getSnapshots() const { return mSnapshots; }
+
+    // host transport at the start of the next block, audio thread only, before processInput()
+    void setTransport(const bool playing, const double ppq, const double bpm, const int numerator, const int denominator)
+    {
+        mSnapshots.setTransport(playing, ppq, bpm, numerator, denominator, mSamplePosition.load(std::memory_order_relaxed), mSampleRate);
+    }
+
+    void setSnapshotResolution(const SnapshotResolution resolution)
+    {
+        mSnapshots.setResolution(resolution);
+    }
+    KeyChordEstimate getKeyChord() const { return mKeyChordEstimator.getEstimate(); }
+
+    // 0 is full quality, higher levels thin out the highest octaves
+    int getQualityLevel() const { return mGovernor.getQualityLevel(); }
+    double getAnalysisLoad() const { return mGovernor.getLoad(); }
+
+    // Deterministic scheduling for offline tools: call setVirtualClock before prepare, then
+    // advanceVirtualClock after every processInput instead of relying on the clock threads.
+    void setVirtualClock(const bool enabled)
+    {
+        mVirtualClock = enabled;
+    }
+
+    void advanceVirtualClock()
+    {
+        if (!mVirtualClock)
+            return;
+
+        // run every call that became due, in octave order, on the calling thread
+        const uint64_t samplePosition = mSamplePosition.load();
+        for (int i = 0; i < OctaveNumber; i++)
+        {
+            while (mOctaveActive[i].load(std::memory_order_relaxed) && mOctaveNextDueSample[i] <= samplePosition)
+            {
+                Cqt::ScheduleElement schedule;
+                schedule.octave = i;
+                threadedCqtCall(schedule);
+                mOctaveNextDueSample[i] += mOctaveIntervalSamples[i];
+            }
+        }
+        while (mHistoryNextDueSample <= samplePosition)
+        {
+            updateHistory();
+            mHistoryNextDueSample += mHistoryIntervalSamples;
+        }
+    }
+
+    // called after every octave frame on the thread that computed it, set before prepare
+    void setFrameListener(FrameListener listener)
+    {
+        mFrameListener = std::move(listener);
+    }
+
+    // Each octave's row is written by the thread computing it, other threads read the magnitudes and
+    // measured frequencies through readMagnitudes() and readInstantaneousFreqs(). The kernel
+    // frequencies only change in prepare() and setTuning(), while no octave call runs.
+    alignas(ArenaAlignment) double mCqtDataStorage[OctaveNumber][B];
+    // magnitudes after the ballistics, for display
+    alignas(ArenaAlignment) double mSmoothedMagnitudes[OctaveNumber][B];
+    double mKernelFreqs[OctaveNumber][B];
+    // measured frequency of each bin, laid out like the magnitudes
+    double mInstantaneousFreqs[OctaveNumber][B];
+    std::atomic<bool> mNewKernelFreqs{ false };
+
+private:
+    void threadedCqtCall(const Cqt::ScheduleElement schedule)
+    {
+        if (!mGovernor.shouldRun(schedule.octave))
+            return;
+        // a call arriving while setTuning swaps the kernels skips its turn
+        std::shared_lock<std::shared_mutex> kernelLock(mKernelMutex, std::try_to_lock);
+        if (!kernelLock.owns_lock())
+            return;
+        // while gated each octave publishes one zero frame, then its calls return right away
+        const bool gated = mGated.load(std::memory_order_acquire);
+        if (gated && mZeroFramePublished[schedule.octave].exchange(true))
+            return;
+        const auto callStart = LoadGovernor<OctaveNumber>::Clock::now();
+        // before the transform, the audio thread keeps pushing while it runs
+        const uint64_t samplePosition = mSamplePosition.load(std::memory_order_relaxed);
+
+        double* real = mArena.getReal(schedule.octave);
+        double* imag = mArena.getImag(schedule.octave);
+        if (gated)
+        {
+            std::fill(real, real + B, 0.);
+            std::fill(imag, imag + B, 0.);
+        }
+        else
+        {
+            mCqt.cqt(schedule);
+            // split into the octave's real and imaginary arrays, the magnitude pass then vectorizes
+            auto cqtData = mCqt.getOctaveCqtBuffer(schedule.octave);
+            for (size_t tone = 0; tone < B; tone++)
+            {
+                real[tone] = (*cqtData)[tone].real();
+                imag[tone] = (*cqtData)[tone].imag();
+            }
+        }
+        double* magnitudes = mCqtDataStorage[schedule.octave];
+        for (size_t tone = 0; tone < B; tone++)
+        {
+            magnitudes[tone] = std::sqrt(real[tone] * real[tone] + imag[tone] * imag[tone]);
+        }
+        mLatestMagnitudes.write(schedule.octave, magnitudes);
+        if (gated)
+        {
+            // a true zero instead of one release step, the display, timeline and aligner hold silence
+            std::fill(mSmoothedMagnitudes[schedule.octave], mSmoothedMagnitudes[schedule.octave] + B, 0.);
+        }
+        else
+        {
+            mBallistics.process(schedule.octave, magnitudes, samplePosition, mSampleRate, mSmoothedMagnitudes[schedule.octave]);
+        }
+        const uint64_t centrePosition = samplePosition - std::min(samplePosition, mWindowCentreOffset[schedule.octave]);
+        mFrameTimeline.push(schedule.octave, mSmoothedMagnitudes[schedule.octave], std::chrono::steady_clock::now());
+        mFrameAligner.push(schedule.octave, centrePosition, mSmoothedMagnitudes[schedule.octave]);
+        mFramePublisher.publish(schedule.octave, samplePosition, centrePosition, mCqtDataStorage[schedule.octave]);
+        mSnapshots.add(schedule.octave, centrePosition, magnitudes);
+        const bool refineFrequencies = mRefineFrequencies.load(std::memory_order_relaxed);
+        if (refineFrequencies && !gated)
+        {
+            mInstantaneousFrequency.process(schedule.octave, real, imag, magnitudes, mKernelFreqs[schedule.octave],
+                samplePosition, mSampleRate, mInstantaneousFreqs[schedule.octave]);
+            mFramePublisher.publishFrequencies(schedule.octave, samplePosition, centrePosition, mInstantaneousFreqs[schedule.octave]);
+        }
+        else
+        {
+            // the bins report their kernel frequencies, the gated zero frame has no phase either,
+            // so the first refined frame after it starts over
+            mInstantaneousFrequency.resetOctave(schedule.octave);
+            std::copy(mKernelFreqs[schedule.octave], mKernelFreqs[schedule.octave] + B, mInstantaneousFreqs[schedule.octave]);
+            if (refineFrequencies)
+                mFramePublisher.publishFrequencies(schedule.octave, samplePosition, centrePosition, mInstantaneousFreqs[schedule.octave]);
+        }
+        mLatestFrequencies.write(schedule.octave, mInstantaneousFreqs[schedule.octave]);
+        mFeatures.updateOctave(schedule.octave, mCqtDataStorage[schedule.octave]);
+        mPitchTracker.process(mLatestMagnitudes, refineFrequencies ? &mLatestFrequencies : nullptr);
+        OnsetEvent onset;
+        if (mOnsetDetector.process(schedule.octave, mCqtDataStorage[schedule.octave], centrePosition, onset))
+        {
+            mFramePublisher.publishOnset(onset.octave, samplePosition, onset.samplePosition, onset.strength);
+        }
+        double chroma[ChromaBins];
+        mFeatures.getChroma(chroma);
+        if (mKeyChordEstimator.process(chroma))
+        {
+            const auto keyChord = mKeyChordEstimator.getEstimate();
+            mFramePublisher.publishKeyChord(samplePosition, keyChord.key, keyChord.chord, keyChord.keyConfidence, keyChord.chordConfidence);
+        }
+        if (mFrameListener)
+            mFrameListener(schedule.octave, samplePosition, mCqtDataStorage[schedule.octave]);
+
+        mGovernor.addBusyTime(LoadGovernor<OctaveNumber>::Clock::now() - callStart);
+    }
+
+    void openGate()
+    {
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            mZeroFramePublished[o].store(false, std::memory_order_relaxed);
+        }
+        mGated.store(false, std::memory_order_release);
+    }
+
+    void updateKernelFreqs()
+    {
+        const auto kernelFreqs = mCqt.getKernelFreqs();
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            for (int tone = 0; tone < B; tone++)
+            {
+                mKernelFreqs[o][tone] = kernelFreqs[o][tone];
+            }
+        }
+        mPitchTracker.setFrequencies(mKernelFreqs[OctaveNumber - 1][0], mTuning.load());
+        if (!mRefineFrequencies.load())
+            resetInstantaneousFreqs();
+        mNewKernelFreqs = true;
+    }
+
+    void resetInstantaneousFreqs()
+    {
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            std::copy(mKernelFreqs[o], mKernelFreqs[o] + B, mInstantaneousFreqs[o]);
+            mLatestFrequencies.write(o, mInstantaneousFreqs[o]);
+        }
+    }
+
+    void attachAnalysisClocks()
+    {
+        if (mVirtualClock)
+            return;
+        for (int i = 0; i < OctaveNumber; i++)
+        {
+            if (!mOctaveActive[i].load())
+                continue;
+            const auto interval = std::max<size_t>(1, static_cast<size_t>(mOctaveIntervalMs[i]));
+            Cqt::ScheduleElement schedule;
+            schedule.octave = i;
+            mCqtClocks[i].attach(std::chrono::milliseconds(interval), std::bind(&CqtEngine::threadedCqtCall, this, schedule));
+        }
+        mHistoryClock.attach(std::chrono::milliseconds(HistoryUpdateRate), std::bind(&CqtEngine::updateHistory, this));
+    }
+
+    void detachAnalysisClocks()
+    {
+        for (int i = 0; i < OctaveNumber; i++)
+        {
+            mCqtClocks[i].detach();
+        }
+        mHistoryClock.detach();
+    }
+
+    void detachClocks()
+    {
+        detachAnalysisClocks();
+        mGovernorClock.detach();
+    }
+
+    void updateHistory()
+    {
+        // the octave threads keep writing their frames, the history gets a consistent copy of each
+        mLatestMagnitudes.read(mHistoryFrame);
+        mHistory.push(mHistoryFrame);
+        // the features change with every octave frame, readers get them at the history rate
+        double chroma[ChromaBins];
+        double octaveMagnitudes[OctaveNumber];
+        mFeatures.getChroma(chroma);
+        mFeatures.getOctaveMagnitudes(octaveMagnitudes);
+        mFramePublisher.publishFeatures(mSamplePosition.load(std::memory_order_relaxed), chroma, ChromaBins, octaveMagnitudes);
+    }
+
+    void updateGovernor()
+    {
+        mGovernor.update();
+    }
+
+    Cqt::ConstantQTransform<B, OctaveNumber> mCqt;
+    EngineArena<B, OctaveNumber> mArena;
+    double mSampleRate{ 0. };
+    std::atomic<double> mTuning{ 440. };
+
+    std::atomic<uint64_t> mSamplePosition{ 0 };
+    SharedMemoryPublisher<B, OctaveNumber> mFramePublisher;
+    FeatureExtractor<B, OctaveNumber> mFeatures;
+    PitchTracker<B, OctaveNumber> mPitchTracker;
+    OnsetDetector<B, OctaveNumber> mOnsetDetector;
+    SpectralSnapshots<B, OctaveNumber> mSnapshots;
+    KeyChordEstimator mKeyChordEstimator;
+    HistoryStore<B, OctaveNumber> mHistory;
+    // history clock thread only
+    double mHistoryFrame[OctaveNumber][B] = {};
+    LatestFrames<B, OctaveNumber> mLatestMagnitudes;
+    LatestFrames<B, OctaveNumber> mLatestFrequencies;
+    LoadGovernor<OctaveNumber> mGovernor;
+    // bound in the constructor, so the audio thread never runs the policy's first-use initialization
+    ThreadPolicy& mThreadPolicy{ ThreadPolicy::getInstance() };
+    InstantaneousFrequency<B, OctaveNumber> mInstantaneousFrequency;
+    FrameTimeline<B, OctaveNumber> mFrameTimeline;
+    FrameAligner<B, OctaveNumber> mFrameAligner;
+    mutable std::mutex mAlignerMutex;
+    uint64_t mWindowCentreOffset[OctaveNumber] = {};
+    uint64_t mAlignedDelaySamples{ 0 };
+    Ballistics<B, OctaveNumber> mBallistics;
+    std::atomic<bool> mRefineFrequencies{ false };
+
+    std::atomic<int> mOctaveOverlap[OctaveNumber];
+    std::atomic<int> mOctaveRateDivisor[OctaveNumber];
+    std::atomic<bool> mOctaveActive[OctaveNumber];
+    std::atomic<double> mMinFrequency{ 0. };
+    std::atomic<double> mMaxFrequency{ 1e6 };
+    PreDecimator mPreDecimator;
+
+    // silence gate, the counters belong to the audio thread
+    std::atomic<bool> mGated{ false };
+    std::atomic<bool> mZeroFramePublished[OctaveNumber];
+    uint64_t mSilentSamples{ 0 };
+    uint64_t mGateHoldSamples{ 0 };
+    double mOctaveIntervalMs[OctaveNumber];
+
+    bool mVirtualClock{ false };
+    uint64_t mOctaveIntervalSamples[OctaveNumber];
+    uint64_t mOctaveNextDueSample[OctaveNumber];
+    uint64_t mHistoryIntervalSamples{ 1 };
+    uint64_t mHistoryNextDueSample{ 0 };
+    FrameListener mFrameListener;
+
+    // periodic calls run on threads shared by all instances with the same interval
+    std::mutex mClockMutex;
+    // shared by the octave calls, held exclusively while the kernels change
+    std::shared_mutex mKernelMutex;
+    std::atomic<bool> mSuspended{ false };
+    SharedClockSubscription mCqtClocks[OctaveNumber];
+    SharedClockSubscription mHistoryClock;
+    SharedClockSubscription mGovernorClock;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+
+constexpr size_t ArenaAlignment{ 64 };
+
+/*
+One cache-line aligned allocation holding the per-instance working buffers of the analysis.
+The input block buffer comes first, followed by one block per octave with the split real and
+imaginary parts of the octave's cqt output. An octave's block is contiguous and starts on a cache
+line, so an octave call touches only its own lines and the arrays can be processed with aligned
+SIMD loads. The arena is sized in prepare(), which must not run concurrently with any user.
+*/
+template <int B, int OctaveNumber>
+class EngineArena
+{
+public:
+    EngineArena() = default;
+    EngineArena(const EngineArena&) = delete;
+    EngineArena& operator=(const EngineArena&) = delete;
+
+    ~EngineArena()
+    {
+        release();
+    }
+
+    void prepare(const int maxBlockSize)
+    {
+        release();
+        mInputStride = roundUp(static_cast<size_t>(maxBlockSize) * sizeof(double));
+        mPartStride = roundUp(B * sizeof(double));
+        mOctaveStride = 2 * mPartStride;
+        mBytes = mInputStride + OctaveNumber * mOctaveStride;
+        mMemory = static_cast<unsigned char*>(::operator new(mBytes, std::align_val_t(ArenaAlignment)));
+        std::memset(mMemory, 0, mBytes);
+    }
+
+    void release()
+    {
+        if (mMemory != nullptr)
+            ::operator delete(mMemory, std::align_val_t(ArenaAlignment));
+        mMemory = nullptr;
+        mBytes = 0;
+    }
+
+    double* getInput()
+    {
+        return reinterpret_cast<double*>(mMemory);
+    }
+
+    double* getReal(const int octave)
+    {
+        return reinterpret_cast<double*>(mMemory + mInputStride + octave * mOctaveStride);
+    }
+
+    double* getImag(const int octave)
+    {
+        return reinterpret_cast<double*>(mMemory + mInputStride + octave * mOctaveStride + mPartStride);
+    }
+
+    // total footprint of the instance's working buffers
+    size_t getBytes() const
+    {
+        return mBytes;
+    }
+
+private:
+    static size_t roundUp(const size_t bytes)
+    {
+        return (bytes + ArenaAlignment - 1) / ArenaAlignment * ArenaAlignment;
+    }
+
+    unsigned char* mMemory{ nullptr };
+    size_t mBytes{ 0 };
+    size_t mInputStride{ 0 };
+    size_t mPartStride{ 0 };
+    size_t mOctaveStride{ 0 };
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+constexpr int ChromaBins{ 12 };
+
+/*
+Chroma and octave magnitude features, updated incrementally whenever an octave frame lands.
+Each octave keeps its own chroma contribution, a new frame only replaces the contribution of its octave
+in the running sum. Mean removal, max search and normalization of the chroma vector are fused into a
+single branch free reduction plus one scaling pass.
+The features are written under a mutex by the octave threads, readers copy them out through the getters.
+*/
+template <int B, int OctaveNumber>
+class FeatureExtractor
+{
+public:
+    static_assert(B % ChromaBins == 0, "bins per octave must be a multiple of 12");
+    static constexpr int BinsPerChroma{ B / ChromaBins };
+    static constexpr int ResyncInterval{ 4096 };
+
+    FeatureExtractor()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            for (int c = 0; c < ChromaBins; c++)
+            {
+                mOctaveChroma[o][c] = 0.;
+            }
+            mOctaveMagnitudes[o] = 0.;
+        }
+        for (int c = 0; c < ChromaBins; c++)
+        {
+            mChromaSum[c] = 0.;
+            mChromaFeature[c] = 0.;
+        }
+    }
+
+    // called from the octave threads with the magnitudes of one octave
+    void updateOctave(const int octave, const double* magnitudes)
+    {
+        // fold bins to semitones, bin 0 is centered on C
+        double chroma[ChromaBins] = {};
+        double octaveSum = 0.;
+        for (int tone = 0; tone < B; tone++)
+        {
+            const int c = ((tone + BinsPerChroma / 2) / BinsPerChroma) % ChromaBins;
+            chroma[c] += magnitudes[tone];
+            octaveSum += magnitudes[tone];
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mOctaveMagnitudes[octave] = octaveSum * (1. / static_cast<double>(B));
+        for (int c = 0; c < ChromaBins; c++)
+        {
+            mChromaSum[c] += chroma[c] - mOctaveChroma[octave][c];
+            mOctaveChroma[octave][c] = chroma[c];
+        }
+        // rebuild the running sum now and then so rounding errors can't accumulate
+        if (++mUpdatesSinceResync == ResyncInterval)
+        {
+            mUpdatesSinceResync = 0;
+            for (int c = 0; c < ChromaBins; c++)
+            {
+                mChromaSum[c] = 0.;
+                for (int o = 0; o < OctaveNumber; o++)
+                {
+                    mChromaSum[c] += mOctaveChroma[o][c];
+                }
+            }
+        }
+        normalizeChroma();
+    }
+
+    // consistent copy of the normalized chroma, any thread
+    void getChroma(double chroma[ChromaBins]) const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (int c = 0; c < ChromaBins; c++)
+        {
+            chroma[c] = mChromaFeature[c];
+        }
+    }
+
+    // consistent copy of the mean magnitude of every octave, any thread
+    void getOctaveMagnitudes(double octaveMagnitudes[OctaveNumber]) const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            octaveMagnitudes[o] = mOctaveMagnitudes[o];
+        }
+    }
+
+private:
+    // zero mean, max absolute value of 1
+    void normalizeChroma()
+    {
+        double sum = 0.;
+        double max = mChromaSum[0];
+        double min = mChromaSum[0];
+        for (int c = 0; c < ChromaBins; c++)
+        {
+            sum += mChromaSum[c];
+            max = std::max(max, mChromaSum[c]);
+            min = std::min(min, mChromaSum[c]);
+        }
+        const double mean = sum * (1. / static_cast<double>(ChromaBins));
+        const double maxAbs = std::max(max - mean, mean - min);
+        const double max1Div = maxAbs > 1e-8 ? 1. / maxAbs : 1.;
+        for (int c = 0; c < ChromaBins; c++)
+        {
+            mChromaFeature[c] = (mChromaSum[c] - mean) * max1Div;
+        }
+    }
+
+    double mChromaFeature[ChromaBins];
+    double mOctaveMagnitudes[OctaveNumber];
+    double mOctaveChroma[OctaveNumber][ChromaBins];
+    double mChromaSum[ChromaBins];
+    int mUpdatesSinceResync{ 0 };
+    mutable std::mutex mMutex;
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+constexpr int FrameAlignerMaxFrames{ 2048 };
+
+/*
+Recent frames of every octave keyed by the input sample their window is centred on, for a display
+that shows all octaves at the same instant. The low octaves' long windows are centred far in the past,
+so the fast octaves are read back from their rings at the centre the slowest octave has reached.
+Ring lengths are set in prepare() from how far each octave has to be delayed, capped at
+FrameAlignerMaxFrames; beyond that an octave shows its oldest frame.
+Each octave is guarded by a sequence number, odd while a frame is being written. push() may run
+concurrently for different octaves, readers never block the writer and retry on a torn read.
+prepare() must not run concurrently with push() or read().
+*/
+template <int B, int OctaveNumber>
+class FrameAligner
+{
+public:
+    void prepare(const int numFrames[OctaveNumber])
+    {
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            auto& ring = mRings[o];
+            ring.size = std::clamp(numFrames[o], 2, FrameAlignerMaxFrames);
+            ring.centres.reset(new std::atomic<uint64_t>[ring.size]);
+            ring.frames.reset(new std::atomic<double>[static_cast<size_t>(ring.size) * B]);
+            for (int i = 0; i < ring.size; i++)
+            {
+                ring.centres[i].store(0, std::memory_order_relaxed);
+            }
+            for (size_t i = 0; i < static_cast<size_t>(ring.size) * B; i++)
+            {
+                ring.frames[i].store(0., std::memory_order_relaxed);
+            }
+            ring.count.store(0);
+            ring.sequence.store(0);
+        }
+    }
+
+    size_t getBytes() const
+    {
+        size_t bytes = 0;
+        for (const auto& ring : mRings)
+        {
+            bytes += static_cast<size_t>(ring.size) * (sizeof(uint64_t) + B * sizeof(double));
+        }
+        return bytes;
+    }
+
+    // octave threads only
+    void push(const int octave, const uint64_t centre, const double* magnitudes)
+    {
+        auto& ring = mRings[octave];
+        if (ring.size == 0)
+            return;
+        const uint64_t count = ring.count.load(std::memory_order_relaxed);
+        const size_t slot = static_cast<size_t>(count % static_cast<uint64_t>(ring.size));
+        const uint64_t sequence = ring.sequence.load(std::memory_order_relaxed);
+        ring.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        ring.centres[slot].store(centre, std::memory_order_relaxed);
+        for (int tone = 0; tone < B; tone++)
+        {
+            ring.frames[slot * B + tone].store(magnitudes[tone], std::memory_order_relaxed);
+        }
+        ring.count.store(count + 1, std::memory_order_relaxed);
+        ring.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // every octave interpolated between the two frames around centre
+    void read(const double centre, double frame[OctaveNumber][B]) const
+    {
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            const auto& ring = mRings[o];
+            if (ring.size == 0)
+                continue;
+            for (;;)
+            {
+                const uint64_t sequence = ring.sequence.load(std::memory_order_acquire);
+                if (sequence & 1)
+                    continue;
+                readOctave(ring, centre, frame[o]);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (ring.sequence.load(std::memory_order_relaxed) == sequence)
+                    break;
+            }
+        }
+    }
+
+private:
+    struct Ring
+    {
+        int size{ 0 };
+        std::unique_ptr<std::atomic<uint64_t>[]> centres;
+        std::unique_ptr<std::atomic<double>[]> frames;
+        std::atomic<uint64_t> count{ 0 };
+        std::atomic<uint64_t> sequence{ 0 };
+    };
+
+    static void readOctave(const Ring& ring, const double centre, double* magnitudes)
+    {
+        const uint64_t count = ring.count.load(std::memory_order_relaxed);
+        const uint64_t available = std::min<uint64_t>(count, static_cast<uint64_t>(ring.size));
+        if (available == 0)
+        {
+            std::fill(magnitudes, magnitudes + B, 0.);
+            return;
+        }
+        // walk back from the newest frame to the first one centred at or before centre
+        uint64_t newer = count - 1;
+        uint64_t older = newer;
+        for (uint64_t i = 0; i < available; i++)
+        {
+            older = count - 1 - i;
+            if (static_cast<double>(ring.centres[older % ring.size].load(std::memory_order_relaxed)) <= centre)
+                break;
+            newer = older;
+        }
+        const size_t olderSlot = static_cast<size_t>(older % ring.size);
+        const size_t newerSlot = static_cast<size_t>(newer % ring.size);
+        const double olderCentre = static_cast<double>(ring.centres[olderSlot].load(std::memory_order_relaxed));
+        const double newerCentre = static_cast<double>(ring.centres[newerSlot].load(std::memory_order_relaxed));
+        const double alpha = newerCentre > olderCentre ? std::clamp((centre - olderCentre) / (newerCentre - olderCentre), 0., 1.) : 0.;
+        for (int tone = 0; tone < B; tone++)
+        {
+            const double olderValue = ring.frames[olderSlot * B + tone].load(std::memory_order_relaxed);
+            const double newerValue = ring.frames[newerSlot * B + tone].load(std::memory_order_relaxed);
+            magnitudes[tone] = olderValue + alpha * (newerValue - olderValue);
+        }
+    }
+
+    Ring mRings[OctaveNumber];
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/*
+The last two frames of every octave with the time they were completed, for displays that run at their
+own rate. A display interpolates between the two frames so that it reaches the newer one one update
+interval after it arrived, which turns the octave's steps into continuous motion at the cost of one
+interval of delay.
+Each octave is guarded by a sequence number, odd while its frames are being replaced. push() may run
+concurrently for different octaves, readers never block the writer and retry on a torn read.
+*/
+template <int B, int OctaveNumber>
+class FrameTimeline
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    FrameTimeline()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            mSequence[o].store(0);
+            mTimeNs[o][0].store(0);
+            mTimeNs[o][1].store(0);
+            for (int tone = 0; tone < B; tone++)
+            {
+                mFrames[o][0][tone].store(0.);
+                mFrames[o][1][tone].store(0.);
+            }
+        }
+    }
+
+    // the newest frame moves to the previous slot, octave threads only
+    void push(const int octave, const double* magnitudes, const Clock::time_point time)
+    {
+        const uint64_t sequence = mSequence[octave].load(std::memory_order_relaxed);
+        mSequence[octave].store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (int tone = 0; tone < B; tone++)
+        {
+            mFrames[octave][0][tone].store(mFrames[octave][1][tone].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            mFrames[octave][1][tone].store(magnitudes[tone], std::memory_order_relaxed);
+        }
+        mTimeNs[octave][0].store(mTimeNs[octave][1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        mTimeNs[octave][1].store(toNs(time), std::memory_order_relaxed);
+        mSequence[octave].store(sequence + 2, std::memory_order_release);
+    }
+
+    Clock::time_point getFrameTime(const int octave) const
+    {
+        return Clock::time_point(std::chrono::nanoseconds(mTimeNs[octave][1].load(std::memory_order_relaxed)));
+    }
+
+    // magnitudes of all octaves as seen at displayTime
+    void interpolate(const Clock::time_point displayTime, double frame[OctaveNumber][B]) const
+    {
+        const int64_t displayNs = toNs(displayTime);
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            for (;;)
+            {
+                const uint64_t sequence = mSequence[o].load(std::memory_order_acquire);
+                if (sequence & 1)
+                    continue;
+                const int64_t previousNs = mTimeNs[o][0].load(std::memory_order_relaxed);
+                const int64_t currentNs = mTimeNs[o][1].load(std::memory_order_relaxed);
+                double alpha = 1.;
+                if (previousNs > 0 && currentNs > previousNs)
+                {
+                    alpha = static_cast<double>(displayNs - currentNs) / static_cast<double>(currentNs - previousNs);
+                    alpha = std::clamp(alpha, 0., 1.);
+                }
+                for (int tone = 0; tone < B; tone++)
+                {
+                    const double previous = mFrames[o][0][tone].load(std::memory_order_relaxed);
+                    const double current = mFrames[o][1][tone].load(std::memory_order_relaxed);
+                    frame[o][tone] = previous + alpha * (current - previous);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (mSequence[o].load(std::memory_order_relaxed) == sequence)
+                    break;
+            }
+        }
+    }
+
+private:
+    static int64_t toNs(const Clock::time_point time)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    }
+
+    std::atomic<uint64_t> mSequence[OctaveNumber];
+    std::atomic<int64_t> mTimeNs[OctaveNumber][2];
+    std::atomic<double> mFrames[OctaveNumber][2][B];
+};
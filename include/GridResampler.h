@@ -0,0 +1,183 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+enum class GridInterpolation
+{
+    Linear,
+    Cubic
+};
+
+/*
+Resamples the multi-rate octave frames onto one uniform grid of rows, e.g. for feature export.
+Frames are keyed by the input sample their window is centred on, row k lies at k * sampleRate / gridRate.
+A row is emitted as soon as every active octave has the frames around it (one more for cubic), so
+each octave only buffers the frames between the next row and its newest frame, i.e. at most the
+span the slowest active octave trails behind. Inactive octaves stay zero.
+Columns run from the lowest bin of the lowest octave upwards, B * OctaveNumber floats per row.
+push() and finish() must be called from one thread, e.g. the frame listener under the virtual clock.
+*/
+template <int B, int OctaveNumber>
+class GridResampler
+{
+public:
+    static constexpr int NumColumns{ B * OctaveNumber };
+    using RowListener = std::function<void(const uint64_t row, const float* values)>;
+
+    void prepare(const double sampleRate, const double gridRate, const GridInterpolation interpolation,
+        const bool activeOctaves[OctaveNumber], RowListener listener)
+    {
+        mRowSamples = sampleRate / std::max(gridRate, 1e-3);
+        mInterpolation = interpolation;
+        mListener = std::move(listener);
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            mActive[o] = activeOctaves[o];
+            mFrames[o].clear();
+        }
+        mRow.fill(0.f);
+        mNextRow = 0;
+    }
+
+    // frames of one octave arrive in increasing centre order
+    void push(const int octave, const uint64_t centre, const double* magnitudes)
+    {
+        if (!mActive[octave])
+            return;
+        Frame frame;
+        frame.centre = static_cast<double>(centre);
+        std::copy(magnitudes, magnitudes + B, frame.magnitudes.begin());
+        mFrames[octave].push_back(frame);
+
+        // the grid advances to the point every active octave can interpolate
+        const size_t lookahead = mInterpolation == GridInterpolation::Cubic ? 1 : 0;
+        double limit = -1.;
+        bool first = true;
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            if (!mActive[o])
+                continue;
+            const auto& frames = mFrames[o];
+            if (frames.size() <= lookahead)
+                return;
+            const double ready = frames[frames.size() - 1 - lookahead].centre;
+            limit = first ? ready : std::min(limit, ready);
+            first = false;
+        }
+        emitRows(limit);
+    }
+
+    // emits the remaining rows up to the newest frame, each octave holds its last value
+    void finish()
+    {
+        double limit = -1.;
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            if (mActive[o] && !mFrames[o].empty())
+                limit = std::max(limit, mFrames[o].back().centre);
+        }
+        emitRows(limit);
+    }
+
+    uint64_t getNumRows() const
+    {
+        return mNextRow;
+    }
+
+private:
+    struct Frame
+    {
+        double centre{ 0. };
+        std::array<double, B> magnitudes{};
+    };
+
+    void emitRows(const double limit)
+    {
+        for (;;)
+        {
+            const double time = static_cast<double>(mNextRow) * mRowSamples;
+            if (time > limit)
+                break;
+            for (int o = 0; o < OctaveNumber; o++)
+            {
+                if (mActive[o] && !mFrames[o].empty())
+                    evaluate(o, time, &mRow[static_cast<size_t>(OctaveNumber - 1 - o) * B]);
+            }
+            if (mListener)
+                mListener(mNextRow, mRow.data());
+            mNextRow++;
+            trim(static_cast<double>(mNextRow) * mRowSamples);
+        }
+    }
+
+    // drops the frames no later row can reach
+    void trim(const double time)
+    {
+        const size_t keep = mInterpolation == GridInterpolation::Cubic ? 2 : 1;
+        for (auto& frames : mFrames)
+        {
+            while (frames.size() > keep + 1 && frames[keep].centre <= time)
+            {
+                frames.pop_front();
+            }
+        }
+    }
+
+    void evaluate(const int octave, const double time, float* values) const
+    {
+        const auto& frames = mFrames[octave];
+        // the last frame centred at or before time, before the first frame the first one holds
+        size_t index = 0;
+        while (index + 1 < frames.size() && frames[index + 1].centre <= time)
+        {
+            index++;
+        }
+        const Frame& current = frames[index];
+        if (index + 1 == frames.size() || time <= current.centre)
+        {
+            for (int tone = 0; tone < B; tone++)
+            {
+                values[tone] = static_cast<float>(current.magnitudes[tone]);
+            }
+            return;
+        }
+        const Frame& next = frames[index + 1];
+        const double alpha = (time - current.centre) / (next.centre - current.centre);
+        if (mInterpolation == GridInterpolation::Linear)
+        {
+            for (int tone = 0; tone < B; tone++)
+            {
+                values[tone] = static_cast<float>(current.magnitudes[tone] + alpha * (next.magnitudes[tone] - current.magnitudes[tone]));
+            }
+            return;
+        }
+        // Catmull-Rom through the neighbours, the ends repeat, overshoot below zero is cut off
+        const Frame& previous = frames[index > 0 ? index - 1 : index];
+        const Frame& after = frames[std::min(index + 2, frames.size() - 1)];
+        const double alpha2 = alpha * alpha;
+        const double alpha3 = alpha2 * alpha;
+        for (int tone = 0; tone < B; tone++)
+        {
+            const double p0 = previous.magnitudes[tone];
+            const double p1 = current.magnitudes[tone];
+            const double p2 = next.magnitudes[tone];
+            const double p3 = after.magnitudes[tone];
+            const double value = 0.5 * (2. * p1 + (p2 - p0) * alpha + (2. * p0 - 5. * p1 + 4. * p2 - p3) * alpha2
+                + (3. * p1 - p0 - 3. * p2 + p3) * alpha3);
+            values[tone] = static_cast<float>(std::max(0., value));
+        }
+    }
+
+    double mRowSamples{ 1. };
+    GridInterpolation mInterpolation{ GridInterpolation::Linear };
+    RowListener mListener;
+    bool mActive[OctaveNumber] = {};
+    std::deque<Frame> mFrames[OctaveNumber];
+    std::array<float, NumColumns> mRow{};
+    uint64_t mNextRow{ 0 };
+};
@@ -0,0 +1,259 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+constexpr int HistoryPyramidFactor{ 4 };
+
+/*
+Ring of magnitude frames spilled into a memory-mapped file.
+Level 0 holds every pushed frame, each further level holds the mean of HistoryPyramidFactor frames
+of the level below, so zoomed out views never have to scan the raw frames.
+Pages that fall out of the resident window are dropped from the process, hence memory stays bounded
+by the resident window while the file (unlinked right after creation) holds the rest of the session.
+Single writer, any number of readers. Each level is guarded by a sequence number, odd while a frame is
+being written, readers never block the writer and retry on a torn read.
+*/
+template <int B, int OctaveNumber>
+class HistoryStore
+{
+public:
+    static constexpr int FrameSize{ B * OctaveNumber };
+    static constexpr size_t FrameBytes{ FrameSize * sizeof(float) };
+    // the mapped file is accessed as atomic floats, readers and the writer may touch the same slot
+    static_assert(sizeof(std::atomic<float>) == sizeof(float) && std::atomic<float>::is_always_lock_free);
+
+    HistoryStore() = default;
+    ~HistoryStore()
+    {
+        close();
+    }
+
+    bool open(const std::string& path, const size_t numFrames, const int numLevels, const size_t residentFrames)
+    {
+        close();
+#if defined(_WIN32)
+        (void)path; (void)numFrames; (void)numLevels; (void)residentFrames;
+        return false;
+#else
+        if (numFrames == 0 || numLevels < 1)
+            return false;
+
+        mPageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        mResidentBytes = residentFrames * FrameBytes;
+
+        // lay out all pyramid levels page aligned in one file
+        size_t totalBytes = 0;
+        size_t capacity = numFrames;
+        for (int l = 0; l < numLevels; l++)
+        {
+            auto level = std::make_unique<Level>();
+            level->offset = totalBytes;
+            level->capacity = capacity > 0 ? capacity : 1;
+            totalBytes += alignToPage(level->capacity * FrameBytes);
+            capacity /= HistoryPyramidFactor;
+            mLevels.push_back(std::move(level));
+        }
+
+        const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0)
+        {
+            mLevels.clear();
+            return false;
+        }
+        // the mapping keeps the file alive, nothing is left behind if the host crashes
+        ::unlink(path.c_str());
+        if (::ftruncate(fd, static_cast<off_t>(totalBytes)) != 0)
+        {
+            ::close(fd);
+            mLevels.clear();
+            return false;
+        }
+        void* mapped = ::mmap(nullptr, totalBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED)
+        {
+            mLevels.clear();
+            return false;
+        }
+        mMapped = static_cast<uint8_t*>(mapped);
+        mMappedBytes = totalBytes;
+
+        for (auto& level : mLevels)
+        {
+            level->data = reinterpret_cast<std::atomic<float>*>(mMapped + level->offset);
+            level->accumulator.assign(FrameSize, 0.);
+        }
+        return true;
+#endif
+    }
+
+    void close()
+    {
+#if !defined(_WIN32)
+        if (mMapped != nullptr)
+        {
+            ::munmap(mMapped, mMappedBytes);
+        }
+#endif
+        mMapped = nullptr;
+        mMappedBytes = 0;
+        mLevels.clear();
+    }
+
+    bool isOpen() const
+    {
+        return mMapped != nullptr;
+    }
+
+    int getNumLevels() const
+    {
+        return static_cast<int>(mLevels.size());
+    }
+
+    // frames a level can currently deliver
+    size_t getNumFrames(const int level) const
+    {
+        if (level < 0 || level >= getNumLevels())
+            return 0;
+        const auto& l = *mLevels[level];
+        const size_t written = l.writeCount.load(std::memory_order_acquire);
+        return written < l.capacity ? written : l.capacity;
+    }
+
+    void push(const double frame[OctaveNumber][B])
+    {
+        if (!isOpen())
+            return;
+        pushLevel(0, &frame[0][0]);
+    }
+
+    // framesAgo == 0 is the newest frame of the level
+    bool read(const int level, const size_t framesAgo, double frame[OctaveNumber][B]) const
+    {
+        if (level < 0 || level >= getNumLevels())
+            return false;
+        const auto& l = *mLevels[level];
+        double* dest = &frame[0][0];
+        for (;;)
+        {
+            const uint64_t sequence = l.sequence.load(std::memory_order_acquire);
+            if (sequence & 1)
+                continue;
+            const size_t written = l.writeCount.load(std::memory_order_relaxed);
+            if (framesAgo >= std::min(written, l.capacity))
+                return false;
+            const std::atomic<float>* src = l.data + ((written - 1 - framesAgo) % l.capacity) * FrameSize;
+            for (int i = 0; i < FrameSize; i++)
+            {
+                dest[i] = static_cast<double>(src[i].load(std::memory_order_relaxed));
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (l.sequence.load(std::memory_order_relaxed) == sequence)
+                return true;
+        }
+    }
+
+private:
+    struct Level
+    {
+        std::atomic<float>* data{ nullptr };
+        size_t offset{ 0 };
+        size_t capacity{ 0 };
+        std::atomic<uint64_t> sequence{ 0 };
+        std::atomic<size_t> writeCount{ 0 };
+        size_t releasedBytes{ 0 };
+        std::vector<double> accumulator;
+        int accumulated{ 0 };
+    };
+
+    void pushLevel(const int level, const double* frame)
+    {
+        auto& l = *mLevels[level];
+        const size_t written = l.writeCount.load(std::memory_order_relaxed);
+        // the slot may be the one a reader copies as its oldest frame
+        const uint64_t sequence = l.sequence.load(std::memory_order_relaxed);
+        l.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::atomic<float>* dest = l.data + (written % l.capacity) * FrameSize;
+        for (int i = 0; i < FrameSize; i++)
+        {
+            dest[i].store(static_cast<float>(frame[i]), std::memory_order_relaxed);
+        }
+        l.writeCount.store(written + 1, std::memory_order_release);
+        l.sequence.store(sequence + 2, std::memory_order_release);
+        releaseColdPages(l);
+
+        if (level + 1 >= getNumLevels())
+            return;
+
+        // decimate into the next pyramid level
+        for (int i = 0; i < FrameSize; i++)
+        {
+            l.accumulator[i] += frame[i];
+        }
+        if (++l.accumulated == HistoryPyramidFactor)
+        {
+            const double scale = 1. / static_cast<double>(HistoryPyramidFactor);
+            for (int i = 0; i < FrameSize; i++)
+            {
+                l.accumulator[i] *= scale;
+            }
+            pushLevel(level + 1, l.accumulator.data());
+            std::fill(l.accumulator.begin(), l.accumulator.end(), 0.);
+            l.accumulated = 0;
+        }
+    }
+
+    // drop pages that are older than the resident window from the working set
+    void releaseColdPages(Level& l)
+    {
+#if !defined(_WIN32)
+        const size_t ringBytes = l.capacity * FrameBytes;
+        if (ringBytes <= mResidentBytes + mPageSize)
+            return;
+        const size_t writtenBytes = l.writeCount.load(std::memory_order_relaxed) * FrameBytes;
+        if (writtenBytes <= mResidentBytes)
+            return;
+        const size_t coldEnd = ((writtenBytes - mResidentBytes) / mPageSize) * mPageSize;
+        if (coldEnd <= l.releasedBytes)
+            return;
+        size_t start = l.releasedBytes % ringBytes;
+        size_t length = coldEnd - l.releasedBytes;
+        while (length > 0)
+        {
+            const size_t chunk = std::min(length, ringBytes - start);
+            const size_t pageStart = (start / mPageSize) * mPageSize;
+            const size_t pageEnd = std::min(alignToPage(start + chunk), alignToPage(ringBytes));
+            ::madvise(mMapped + l.offset + pageStart, pageEnd - pageStart, MADV_DONTNEED);
+            length -= chunk;
+            start = 0;
+        }
+        l.releasedBytes = coldEnd;
+#else
+        (void)l;
+#endif
+    }
+
+    size_t alignToPage(const size_t bytes) const
+    {
+        return ((bytes + mPageSize - 1) / mPageSize) * mPageSize;
+    }
+
+    uint8_t* mMapped{ nullptr };
+    size_t mMappedBytes{ 0 };
+    size_t mPageSize{ 4096 };
+    size_t mResidentBytes{ 0 };
+    std::vector<std::unique_ptr<Level>> mLevels;
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+/*
+Phase-vocoder refinement of the bin frequencies.
+Between two calls of an octave the input advanced by a known number of samples, so a stationary
+partial at frequency f rotates the phase of the bins it falls into by 2 pi f dt. The deviation of the
+measured phase advance from the one expected at the kernel frequency, wrapped to +-pi, gives the
+offset of the partial from the bin centre with far better resolution than the bin spacing.
+The deviation is only unambiguous for offsets below 1 / (2 dt), so a bin is only refined while that
+covers one bin width, i.e. while dt is less than half its kernel length. With the hop of one call per
+octave this holds for the lower bins of each octave only, the others report their kernel frequency,
+as do bins below the magnitude floor. Results further away than one bin are treated as leakage and clamped.
+Each octave has its own state, so the octave threads may call process() concurrently for different octaves.
+*/
+template <int B, int OctaveNumber>
+class InstantaneousFrequency
+{
+public:
+    static constexpr double MagnitudeFloor{ 1e-6 };
+    static constexpr double Pi{ 3.14159265358979323846 };
+
+    InstantaneousFrequency()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            mHasPhase[o].store(false);
+        }
+    }
+
+    // forgets the octave's phase, e.g. after a gap in its input, its next call reports kernel frequencies
+    void resetOctave(const int octave)
+    {
+        mHasPhase[octave].store(false, std::memory_order_relaxed);
+    }
+
+    /*
+    Refines the frequencies of one octave from its complex cqt output at samplePosition (input samples
+    at sampleRate, read before the transform ran). frequencies is left untouched when no input arrived since the octave's previous call.
+    */
+    void process(const int octave, const double* real, const double* imag, const double* magnitudes,
+        const double* kernelFreqs, const uint64_t samplePosition, const double sampleRate, double* frequencies)
+    {
+        double* previousPhase = mPreviousPhase[octave];
+        const bool hasPhase = mHasPhase[octave].load(std::memory_order_relaxed);
+        const uint64_t elapsed = samplePosition - mPreviousPosition[octave];
+        if (hasPhase && elapsed == 0)
+            return;
+
+        const double dt = static_cast<double>(elapsed) / sampleRate;
+        const double binRatio = std::exp2(1. / static_cast<double>(B)) - 1.;
+        for (int tone = 0; tone < B; tone++)
+        {
+            const double phase = std::atan2(imag[tone], real[tone]);
+            const double kernelFreq = kernelFreqs[tone];
+            double frequency = kernelFreq;
+            const double binWidth = kernelFreq * binRatio;
+            // the kernel spans about 1 / binWidth seconds
+            if (hasPhase && magnitudes[tone] > MagnitudeFloor && dt * binWidth < 0.5)
+            {
+                const double expected = 2. * Pi * kernelFreq * dt;
+                const double deviation = wrap(phase - previousPhase[tone] - expected);
+                frequency = kernelFreq + std::clamp(deviation / (2. * Pi * dt), -binWidth, binWidth);
+            }
+            frequencies[tone] = frequency;
+            previousPhase[tone] = phase;
+        }
+        mPreviousPosition[octave] = samplePosition;
+        mHasPhase[octave].store(true, std::memory_order_relaxed);
+    }
+
+private:
+    static double wrap(const double phase)
+    {
+        return phase - 2. * Pi * std::round(phase / (2. * Pi));
+    }
+
+    double mPreviousPhase[OctaveNumber][B] = {};
+    uint64_t mPreviousPosition[OctaveNumber] = {};
+    std::atomic<bool> mHasPhase[OctaveNumber];
+};
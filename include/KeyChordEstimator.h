@@ -0,0 +1,251 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+constexpr int KeyNumber{ 24 };
+constexpr int ChordNumber{ 25 }; // 12 major, 12 minor triads and no chord
+constexpr int ChordViterbiLag{ 16 };
+
+struct KeyChordEstimate
+{
+    int key{ -1 };
+    int chord{ ChordNumber - 1 };
+    double keyConfidence{ 0. };
+    double chordConfidence{ 0. };
+
+    // index 0-11 major, 12-23 minor
+    static std::string getKeyName(const int key)
+    {
+        static const char* names[12] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
+        if (key < 0 || key >= KeyNumber)
+            return "-";
+        return std::string(names[key % 12]) + (key < 12 ? " major" : " minor");
+    }
+
+    static std::string getChordName(const int chord)
+    {
+        static const char* names[12] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
+        if (chord < 0 || chord >= ChordNumber - 1)
+            return "N";
+        return std::string(names[chord % 12]) + (chord < 12 ? "" : "m");
+    }
+};
+
+/*
+Incremental key and chord estimation on a 12 bin chroma vector.
+Keys are found by correlating a slowly averaged chroma with the Krumhansl-Kessler profiles.
+Chords are found by correlating each chroma frame with binary triad templates, the frame scores are
+smoothed by an online Viterbi decoder with a fixed lag of ChordViterbiLag frames. The transition model
+only distinguishes staying and switching, hence every update costs O(ChordNumber + ChordViterbiLag).
+All state lives in fixed size members, nothing is allocated after construction.
+*/
+class KeyChordEstimator
+{
+public:
+    KeyChordEstimator()
+    {
+        static const double majorProfile[12] = { 6.35, 2.23, 3.48, 2.33, 4.38, 4.09, 2.52, 5.19, 2.39, 3.66, 2.29, 2.88 };
+        static const double minorProfile[12] = { 6.33, 2.68, 3.52, 5.38, 2.60, 3.53, 2.54, 4.75, 3.98, 2.69, 3.34, 3.17 };
+        for (int root = 0; root < 12; root++)
+        {
+            for (int c = 0; c < 12; c++)
+            {
+                const int interval = (c - root + 12) % 12;
+                mKeyTemplates[root][c] = majorProfile[interval];
+                mKeyTemplates[root + 12][c] = minorProfile[interval];
+                const bool majorTone = interval == 0 || interval == 4 || interval == 7;
+                const bool minorTone = interval == 0 || interval == 3 || interval == 7;
+                mChordTemplates[root][c] = majorTone ? 1. : 0.;
+                mChordTemplates[root + 12][c] = minorTone ? 1. : 0.;
+            }
+        }
+        for (int k = 0; k < KeyNumber; k++)
+        {
+            normalizeTemplate(mKeyTemplates[k]);
+        }
+        for (int chord = 0; chord < ChordNumber - 1; chord++)
+        {
+            normalizeTemplate(mChordTemplates[chord]);
+        }
+        reset();
+    }
+
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(mProcessMutex);
+        for (int c = 0; c < 12; c++)
+        {
+            mKeyChroma[c] = 0.;
+        }
+        for (int s = 0; s < ChordNumber; s++)
+        {
+            mScores[s] = 0.;
+        }
+        mFrame = 0;
+        std::lock_guard<std::mutex> resultLock(mResultMutex);
+        mEstimate = KeyChordEstimate{};
+    }
+
+    /*
+    Feeds one chroma frame. Concurrent calls never wait, a call arriving while another
+    one is running is skipped.
+    Returns true if the published key or chord changed.
+    */
+    bool process(const double chroma[12])
+    {
+        std::unique_lock<std::mutex> lock(mProcessMutex, std::try_to_lock);
+        if (!lock.owns_lock())
+            return false;
+
+        // zero mean, unit length chroma
+        double frame[12];
+        double mean = 0.;
+        for (int c = 0; c < 12; c++)
+        {
+            frame[c] = std::max(0., chroma[c]);
+            mean += frame[c];
+        }
+        mean *= 1. / 12.;
+        double norm = 0.;
+        for (int c = 0; c < 12; c++)
+        {
+            frame[c] -= mean;
+            norm += frame[c] * frame[c];
+        }
+        const bool silent = norm < 1e-12;
+        const double norm1Div = silent ? 0. : 1. / std::sqrt(norm);
+
+        // key from slowly averaged chroma
+        for (int c = 0; c < 12; c++)
+        {
+            frame[c] *= norm1Div;
+            mKeyChroma[c] = KeyAveraging * mKeyChroma[c] + (1. - KeyAveraging) * frame[c];
+        }
+        int key = 0;
+        double keyCorrelation = -2.;
+        for (int k = 0; k < KeyNumber; k++)
+        {
+            const double correlation = dot(mKeyTemplates[k], mKeyChroma);
+            if (correlation > keyCorrelation)
+            {
+                keyCorrelation = correlation;
+                key = k;
+            }
+        }
+
+        // online viterbi step over the chord states
+        double best = mScores[0];
+        for (int s = 1; s < ChordNumber; s++)
+        {
+            best = std::max(best, mScores[s]);
+        }
+        const int slot = mFrame % ChordViterbiLag;
+        for (int s = 0; s < ChordNumber; s++)
+        {
+            const double emission = s < ChordNumber - 1 ? dot(mChordTemplates[s], frame) : NoChordCorrelation;
+            const double stay = mScores[s] + LogStay;
+            const double change = best + LogChange;
+            mBackPointers[slot][s] = stay >= change ? s : mBestState;
+            mScores[s] = std::max(stay, change) + EmissionScale * (silent ? (s == ChordNumber - 1 ? 1. : 0.) : emission);
+        }
+        // keep scores bounded
+        mBestState = 0;
+        for (int s = 1; s < ChordNumber; s++)
+        {
+            if (mScores[s] > mScores[mBestState])
+                mBestState = s;
+        }
+        const double offset = mScores[mBestState];
+        for (int s = 0; s < ChordNumber; s++)
+        {
+            mScores[s] -= offset;
+        }
+        mFrame++;
+
+        // fixed lag decision, backtrack through the ring
+        int state = mBestState;
+        const int lag = mFrame < ChordViterbiLag ? static_cast<int>(mFrame) - 1 : ChordViterbiLag - 1;
+        for (int i = 0; i < lag; i++)
+        {
+            state = mBackPointers[(mFrame - 1 - i) % ChordViterbiLag][state];
+        }
+        double secondBest = -1e300;
+        for (int s = 0; s < ChordNumber; s++)
+        {
+            if (s != mBestState)
+                secondBest = std::max(secondBest, mScores[s]);
+        }
+
+        KeyChordEstimate estimate;
+        estimate.key = silent && mEstimate.key < 0 ? -1 : key;
+        estimate.keyConfidence = std::max(0., keyCorrelation);
+        estimate.chord = state;
+        estimate.chordConfidence = 1. - std::exp(std::max(-50., secondBest));
+
+        std::lock_guard<std::mutex> resultLock(mResultMutex);
+        const bool changed = estimate.key != mEstimate.key || estimate.chord != mEstimate.chord;
+        mEstimate = estimate;
+        return changed;
+    }
+
+    KeyChordEstimate getEstimate() const
+    {
+        std::lock_guard<std::mutex> resultLock(mResultMutex);
+        return mEstimate;
+    }
+
+private:
+    static constexpr double KeyAveraging{ 0.995 };
+    static constexpr double NoChordCorrelation{ 0.3 };
+    static constexpr double EmissionScale{ 8. };
+    static constexpr double LogStay{ -0.03 };   // log(0.97)
+    static constexpr double LogChange{ -3.5 };  // log(0.03)
+
+    static void normalizeTemplate(double (&t)[12])
+    {
+        double mean = 0.;
+        for (int c = 0; c < 12; c++)
+        {
+            mean += t[c];
+        }
+        mean *= 1. / 12.;
+        double norm = 0.;
+        for (int c = 0; c < 12; c++)
+        {
+            t[c] -= mean;
+            norm += t[c] * t[c];
+        }
+        const double norm1Div = 1. / std::sqrt(norm);
+        for (int c = 0; c < 12; c++)
+        {
+            t[c] *= norm1Div;
+        }
+    }
+
+    static double dot(const double (&a)[12], const double (&b)[12])
+    {
+        double sum = 0.;
+        for (int c = 0; c < 12; c++)
+        {
+            sum += a[c] * b[c];
+        }
+        return sum;
+    }
+
+    double mKeyTemplates[KeyNumber][12];
+    double mChordTemplates[ChordNumber - 1][12];
+
+    double mKeyChroma[12];
+    double mScores[ChordNumber];
+    int mBackPointers[ChordViterbiLag][ChordNumber] = {};
+    int mBestState{ ChordNumber - 1 };
+    uint64_t mFrame{ 0 };
+
+    std::mutex mProcessMutex;
+    mutable std::mutex mResultMutex;
+    KeyChordEstimate mEstimate;
+};
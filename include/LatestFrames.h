@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/*
+The newest frame of every octave, for readers on other threads than the octave's own.
+Each octave is guarded by a sequence number, odd while its frame is being replaced. write() may run
+concurrently for different octaves, each octave has one writer. Readers never block the writer and
+retry on a torn read.
+*/
+template <int B, int OctaveNumber>
+class LatestFrames
+{
+public:
+    LatestFrames()
+    {
+        reset();
+    }
+
+    // no write() may run concurrently
+    void reset()
+    {
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            mSequence[o].store(0);
+            for (int tone = 0; tone < B; tone++)
+            {
+                mFrames[o][tone].store(0.);
+            }
+        }
+    }
+
+    void write(const int octave, const double* values)
+    {
+        const uint64_t sequence = mSequence[octave].load(std::memory_order_relaxed);
+        mSequence[octave].store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (int tone = 0; tone < B; tone++)
+        {
+            mFrames[octave][tone].store(values[tone], std::memory_order_relaxed);
+        }
+        mSequence[octave].store(sequence + 2, std::memory_order_release);
+    }
+
+    void readOctave(const int octave, double* values) const
+    {
+        for (;;)
+        {
+            const uint64_t sequence = mSequence[octave].load(std::memory_order_acquire);
+            if (sequence & 1)
+                continue;
+            for (int tone = 0; tone < B; tone++)
+            {
+                values[tone] = mFrames[octave][tone].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (mSequence[octave].load(std::memory_order_relaxed) == sequence)
+                return;
+        }
+    }
+
+    void read(double frame[OctaveNumber][B]) const
+    {
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            readOctave(o, frame[o]);
+        }
+    }
+
+private:
+    std::atomic<uint64_t> mSequence[OctaveNumber];
+    std::atomic<double> mFrames[OctaveNumber][B];
+};
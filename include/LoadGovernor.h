@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+constexpr int GovernorMaxLevel{ 4 };
+
+/*
+Keeps the analysis within a CPU budget by thinning out octave updates.
+The time spent in the octave calls is accumulated and compared against the budget, given as share of
+one core, whenever update() is called. Above budget the quality level rises, well below it falls again.
+At level q octave o (0 being the highest) only runs every 2^(q - o)th call, so the highest octaves,
+which have the shortest hops and run most often, are thinned first and strongest.
+*/
+template <int OctaveNumber>
+class LoadGovernor
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    LoadGovernor()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            mCallCounters[o].store(0);
+        }
+        mBusyNanoseconds.store(0);
+        mLevel.store(0);
+        mLoad.store(0.);
+        mLastUpdate = Clock::now();
+    }
+
+    void setBudget(const double budget)
+    {
+        mBudget.store(std::max(0.01, budget));
+    }
+
+    double getBudget() const
+    {
+        return mBudget.load();
+    }
+
+    // decides whether the octave's call runs at the current quality level
+    bool shouldRun(const int octave)
+    {
+        const int level = mLevel.load(std::memory_order_relaxed);
+        const int shift = level - octave;
+        if (shift <= 0)
+            return true;
+        const uint64_t divider = uint64_t{ 1 } << shift;
+        return mCallCounters[octave].fetch_add(1, std::memory_order_relaxed) % divider == 0;
+    }
+
+    void addBusyTime(const Clock::duration busy)
+    {
+        mBusyNanoseconds.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(busy).count()), std::memory_order_relaxed);
+    }
+
+    // called periodically from a single thread
+    void update()
+    {
+        const auto now = Clock::now();
+        const double elapsed = std::chrono::duration<double>(now - mLastUpdate).count();
+        if (elapsed <= 0.)
+            return;
+        mLastUpdate = now;
+        const double busy = 1e-9 * static_cast<double>(mBusyNanoseconds.exchange(0));
+        const double load = busy / elapsed;
+        mLoad.store(load);
+
+        const double budget = mBudget.load();
+        int level = mLevel.load();
+        if (load > budget && level < GovernorMaxLevel)
+        {
+            level++;
+        }
+        else if (load < RestoreRatio * budget && level > 0)
+        {
+            level--;
+        }
+        mLevel.store(level);
+    }
+
+    // 0 is full quality, GovernorMaxLevel the strongest thinning
+    int getQualityLevel() const
+    {
+        return mLevel.load();
+    }
+
+    // share of one core the analysis used in the last update interval
+    double getLoad() const
+    {
+        return mLoad.load();
+    }
+
+private:
+    static constexpr double RestoreRatio{ 0.5 };
+
+    std::atomic<uint64_t> mCallCounters[OctaveNumber];
+    std::atomic<uint64_t> mBusyNanoseconds{ 0 };
+    std::atomic<int> mLevel{ 0 };
+    std::atomic<double> mLoad{ 0. };
+    std::atomic<double> mBudget{ 0.5 };
+    Clock::time_point mLastUpdate;
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+
+constexpr int OnsetMedianLength{ 7 };
+constexpr int OnsetEventCapacity{ 256 };
+
+struct OnsetEvent
+{
+    // input sample the analysis window of the detecting frame was centred on
+    uint64_t samplePosition{ 0 };
+    int octave{ 0 };
+    double strength{ 0. };
+};
+
+/*
+Spectral flux onset detection, computed per octave whenever the octave's frame arrives.
+Flux is the half-wave rectified increase of the log magnitudes against the octave's previous frame.
+An onset is reported on the rising edge of the flux crossing an adaptive threshold, which is the
+median of the octave's last OnsetMedianLength flux values plus a fixed offset.
+Each octave's state is only touched by its own thread, detected events go into a shared ring.
+*/
+template <int B, int OctaveNumber>
+class OnsetDetector
+{
+public:
+    OnsetDetector()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            auto& state = mStates[o];
+            for (int tone = 0; tone < B; tone++)
+            {
+                state.previous[tone] = FloorDb;
+            }
+            for (int i = 0; i < OnsetMedianLength; i++)
+            {
+                state.fluxHistory[i] = 0.;
+            }
+            state.historyIndex = 0;
+            state.aboveThreshold = false;
+        }
+        std::lock_guard<std::mutex> lock(mEventMutex);
+        mNumEvents = 0;
+    }
+
+    void setThreshold(const double thresholdDb)
+    {
+        mThresholdDb = thresholdDb;
+    }
+
+    // returns true and fills event if the frame, whose window is centred on input sample centrePosition, holds an onset
+    bool process(const int octave, const double* magnitudes, const uint64_t centrePosition, OnsetEvent& event)
+    {
+        auto& state = mStates[octave];
+
+        double flux = 0.;
+        for (int tone = 0; tone < B; tone++)
+        {
+            const double magDb = 20. * std::log10(std::max(magnitudes[tone], MinMagnitude));
+            flux += std::max(0., magDb - state.previous[tone]);
+            state.previous[tone] = magDb;
+        }
+        flux *= 1. / static_cast<double>(B);
+
+        double sorted[OnsetMedianLength];
+        std::copy(state.fluxHistory, state.fluxHistory + OnsetMedianLength, sorted);
+        std::nth_element(sorted, sorted + OnsetMedianLength / 2, sorted + OnsetMedianLength);
+        const double threshold = sorted[OnsetMedianLength / 2] + mThresholdDb.load();
+
+        state.fluxHistory[state.historyIndex] = flux;
+        state.historyIndex = (state.historyIndex + 1) % OnsetMedianLength;
+
+        const bool above = flux > threshold;
+        const bool onset = above && !state.aboveThreshold;
+        state.aboveThreshold = above;
+        if (!onset)
+            return false;
+
+        // the flux peaks as the onset crosses the centre of the window, wherever the clock tick fell
+        event.samplePosition = centrePosition;
+        event.octave = octave;
+        event.strength = flux - threshold;
+
+        std::lock_guard<std::mutex> lock(mEventMutex);
+        mEvents[mNumEvents % OnsetEventCapacity] = event;
+        mNumEvents++;
+        return true;
+    }
+
+    // total number of events detected since reset, older ones are overwritten
+    uint64_t getNumEvents() const
+    {
+        std::lock_guard<std::mutex> lock(mEventMutex);
+        return mNumEvents;
+    }
+
+    bool getEvent(const uint64_t index, OnsetEvent& event) const
+    {
+        std::lock_guard<std::mutex> lock(mEventMutex);
+        if (index >= mNumEvents || mNumEvents - index > OnsetEventCapacity)
+            return false;
+        event = mEvents[index % OnsetEventCapacity];
+        return true;
+    }
+
+private:
+    static constexpr double MinMagnitude{ 1e-5 };
+    static constexpr double FloorDb{ -100. };
+
+    struct OctaveState
+    {
+        double previous[B];
+        double fluxHistory[OnsetMedianLength];
+        int historyIndex{ 0 };
+        bool aboveThreshold{ false };
+    };
+
+    OctaveState mStates[OctaveNumber];
+    std::atomic<double> mThresholdDb{ 3. };
+
+    mutable std::mutex mEventMutex;
+    OnsetEvent mEvents[OnsetEventCapacity];
+    uint64_t mNumEvents{ 0 };
+};
@@ -0,0 +1,206 @@
+#pragma once
+
+#include "LatestFrames.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <string>
+
+constexpr int PitchHarmonics{ 8 };
+constexpr int PitchMaxVoices{ 3 };
+
+struct PitchEstimate
+{
+    double frequency{ 0. };
+    int midiNote{ -1 };
+    double cents{ 0. };
+    double confidence{ 0. };
+
+    bool isValid() const
+    {
+        return midiNote >= 0;
+    }
+
+    std::string getNoteName() const
+    {
+        static const char* names[12] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
+        if (!isValid())
+            return "-";
+        return std::string(names[midiNote % 12]) + std::to_string(midiNote / 12 - 1);
+    }
+};
+
+/*
+Monophonic and light polyphonic pitch estimation on the cqt magnitudes.
+All octaves are laid out on one log-frequency axis, where harmonic h sits a constant B * log2(h) bins
+above the fundamental. Harmonic summation hence is a weighted shift-and-add of the compressed spectrum.
+The best candidate is refined by parabolic interpolation, its harmonics are removed and the search
+repeats for up to PitchMaxVoices voices. All buffers are fixed size, no allocation happens per frame.
+*/
+template <int B, int OctaveNumber>
+class PitchTracker
+{
+public:
+    static constexpr int NumBins{ B * OctaveNumber };
+
+    PitchTracker()
+    {
+        for (int h = 0; h < PitchHarmonics; h++)
+        {
+            mHarmonicOffsets[h] = static_cast<int>(std::round(static_cast<double>(B) * std::log2(static_cast<double>(h + 1))));
+            mHarmonicWeights[h] = std::pow(0.84, static_cast<double>(h));
+        }
+        mMaxCandidate = NumBins - mHarmonicOffsets[1];
+    }
+
+    // frequency of the lowest bin of the lowest octave and the concert pitch notes are related to
+    void setFrequencies(const double lowestBinFrequency, const double tuning)
+    {
+        mLowestBinFrequency.store(lowestBinFrequency);
+        mTuning.store(tuning);
+    }
+
+    void setConfidenceThreshold(const double threshold)
+    {
+        mConfidenceThreshold.store(threshold);
+    }
+
+    /*
+    Estimates pitches from the newest magnitudes of all octaves, octave 0 being the highest octave.
+    With the measured bin frequencies in the same layout the peak's frequency is taken from there
+    instead of being interpolated between bins.
+    Concurrent calls from several octave threads never wait, the call arriving while another
+    one is running is skipped. The frames are copied out first, the other octaves keep writing theirs.
+    */
+    void process(const LatestFrames<B, OctaveNumber>& magnitudes, const LatestFrames<B, OctaveNumber>* frequencies = nullptr)
+    {
+        std::unique_lock<std::mutex> lock(mProcessMutex, std::try_to_lock);
+        if (!lock.owns_lock())
+            return;
+        magnitudes.read(mMagnitudes);
+        if (frequencies != nullptr)
+            frequencies->read(mFrequencies);
+
+        // low to high log-frequency axis, log compressed
+        double total = 0.;
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            double* dest = mSpectrum.data() + (OctaveNumber - o - 1) * B;
+            for (int tone = 0; tone < B; tone++)
+            {
+                dest[tone] = std::log1p(1000. * mMagnitudes[o][tone]);
+                total += dest[tone];
+            }
+        }
+
+        std::array<PitchEstimate, PitchMaxVoices> estimates;
+        const double lowestBinFrequency = mLowestBinFrequency.load();
+        const double tuning = mTuning.load();
+        const double threshold = mConfidenceThreshold.load();
+        for (int voice = 0; voice < PitchMaxVoices && total > 1e-9; voice++)
+        {
+            harmonicSum();
+
+            int peak = 1;
+            for (int g = 2; g < mMaxCandidate - 1; g++)
+            {
+                if (mSalience[g] > mSalience[peak])
+                    peak = g;
+            }
+            // share of the remaining spectrum explained by the candidate's harmonics
+            double explained = 0.;
+            for (int h = 0; h < PitchHarmonics && peak + mHarmonicOffsets[h] < NumBins; h++)
+            {
+                const int g = peak + mHarmonicOffsets[h];
+                for (int n = std::max(0, g - 1); n <= std::min(NumBins - 1, g + 1); n++)
+                {
+                    explained += mSpectrum[n];
+                }
+            }
+            const double confidence = std::min(1., explained / total);
+            if (confidence < threshold)
+                break;
+
+            // parabolic interpolation between neighbouring bins
+            const double left = mSalience[peak - 1];
+            const double centre = mSalience[peak];
+            const double right = mSalience[peak + 1];
+            const double denominator = left - 2. * centre + right;
+            const double delta = std::abs(denominator) > 1e-12 ? 0.5 * (left - right) / denominator : 0.;
+
+            auto& estimate = estimates[voice];
+            estimate.frequency = lowestBinFrequency * std::exp2((static_cast<double>(peak) + delta) / static_cast<double>(B));
+            if (frequencies != nullptr)
+            {
+                // the measured frequency counts only if it agrees with the interpolated one to within a bin
+                const double measured = mFrequencies[OctaveNumber - 1 - peak / B][peak % B];
+                if (std::abs(std::log2(measured / estimate.frequency)) < 1. / static_cast<double>(B))
+                    estimate.frequency = measured;
+            }
+            const double midi = 69. + 12. * std::log2(estimate.frequency / tuning);
+            estimate.midiNote = static_cast<int>(std::round(midi));
+            estimate.cents = 100. * (midi - static_cast<double>(estimate.midiNote));
+            estimate.confidence = confidence;
+
+            // remove the voice's harmonics before searching the next one
+            for (int h = 0; h < PitchHarmonics && peak + mHarmonicOffsets[h] < NumBins; h++)
+            {
+                const int g = peak + mHarmonicOffsets[h];
+                for (int n = std::max(0, g - 1); n <= std::min(NumBins - 1, g + 1); n++)
+                {
+                    total -= mSpectrum[n];
+                    mSpectrum[n] = 0.;
+                }
+            }
+        }
+
+        // publish
+        std::lock_guard<std::mutex> resultLock(mResultMutex);
+        mEstimates = estimates;
+    }
+
+    std::array<PitchEstimate, PitchMaxVoices> getEstimates() const
+    {
+        std::lock_guard<std::mutex> resultLock(mResultMutex);
+        return mEstimates;
+    }
+
+private:
+    void harmonicSum()
+    {
+        for (int g = 0; g < mMaxCandidate; g++)
+        {
+            mSalience[g] = 0.;
+        }
+        for (int h = 0; h < PitchHarmonics; h++)
+        {
+            const int offset = mHarmonicOffsets[h];
+            const double weight = mHarmonicWeights[h];
+            const int end = std::min(mMaxCandidate, NumBins - offset);
+            for (int g = 0; g < end; g++)
+            {
+                mSalience[g] += weight * mSpectrum[g + offset];
+            }
+        }
+    }
+
+    // copies of the octaves' frames, only touched under mProcessMutex
+    double mMagnitudes[OctaveNumber][B] = {};
+    double mFrequencies[OctaveNumber][B] = {};
+    std::array<double, NumBins> mSpectrum{};
+    std::array<double, NumBins> mSalience{};
+    int mHarmonicOffsets[PitchHarmonics];
+    double mHarmonicWeights[PitchHarmonics];
+    int mMaxCandidate{ NumBins };
+
+    std::atomic<double> mLowestBinFrequency{ 20. };
+    std::atomic<double> mTuning{ 440. };
+    std::atomic<double> mConfidenceThreshold{ 0.3 };
+
+    std::mutex mProcessMutex;
+    mutable std::mutex mResultMutex;
+    std::array<PitchEstimate, PitchMaxVoices> mEstimates;
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cmath>
+
+constexpr int PreDecimatorMaxStages{ 3 };
+constexpr int PreDecimatorTaps{ 63 };
+constexpr double PreDecimatorMaxRate{ 50000. };
+
+/*
+Halves the input rate up to PreDecimatorMaxStages times ahead of the cqt, so that at 88.2 kHz and above
+the octave chain starts at the top of the audible band instead of spending its highest octaves on
+ultrasound. Each stage is a Blackman windowed half-band FIR, whose even taps apart from the centre are
+zero, so an output sample costs one multiply per odd tap pair.
+Runs in place on the audio thread without allocating, prepare() must not run concurrently.
+*/
+class PreDecimator
+{
+public:
+    PreDecimator()
+    {
+        constexpr int centre = PreDecimatorTaps / 2;
+        constexpr double pi = 3.14159265358979323846;
+        double sum = 0.;
+        for (int n = 0; n < PreDecimatorTaps; n++)
+        {
+            const double x = static_cast<double>(n - centre);
+            const double sinc = n == centre ? 1. : std::sin(pi * 0.5 * x) / (pi * 0.5 * x);
+            const double phase = 2. * pi * static_cast<double>(n) / static_cast<double>(PreDecimatorTaps - 1);
+            const double window = 0.42 - 0.5 * std::cos(phase) + 0.08 * std::cos(2. * phase);
+            mTaps[n] = 0.5 * sinc * window;
+            sum += mTaps[n];
+        }
+        for (int n = 0; n < PreDecimatorTaps; n++)
+        {
+            mTaps[n] /= sum;
+        }
+    }
+
+    // number of halvings for sampleRate, the resulting rate is at most PreDecimatorMaxRate where possible
+    static int getStagesFor(const double sampleRate)
+    {
+        int stages = 0;
+        while (stages < PreDecimatorMaxStages && sampleRate / static_cast<double>(1 << stages) > PreDecimatorMaxRate)
+        {
+            stages++;
+        }
+        return stages;
+    }
+
+    void prepare(const int stages)
+    {
+        mNumStages = stages;
+        for (auto& stage : mStages)
+        {
+            for (double& sample : stage.history)
+            {
+                sample = 0.;
+            }
+            stage.position = 0;
+            stage.skip = false;
+        }
+    }
+
+    int getFactor() const
+    {
+        return 1 << mNumStages;
+    }
+
+    // decimates numSamples in place and returns the number of output samples
+    int process(double* samples, int numSamples)
+    {
+        for (int s = 0; s < mNumStages; s++)
+        {
+            numSamples = processStage(mStages[s], samples, numSamples);
+        }
+        return numSamples;
+    }
+
+private:
+    struct Stage
+    {
+        // the taps as a doubled ring, so a window is always one contiguous run
+        double history[2 * PreDecimatorTaps];
+        int position{ 0 };
+        bool skip{ false };
+    };
+
+    int processStage(Stage& stage, double* samples, const int numSamples)
+    {
+        constexpr int centre = PreDecimatorTaps / 2;
+        int numOutput = 0;
+        for (int i = 0; i < numSamples; i++)
+        {
+            stage.history[stage.position] = samples[i];
+            stage.history[stage.position + PreDecimatorTaps] = samples[i];
+            stage.position = stage.position + 1 == PreDecimatorTaps ? 0 : stage.position + 1;
+            // every other input sample yields an output, the phase carries across blocks
+            stage.skip = !stage.skip;
+            if (!stage.skip)
+                continue;
+            const double* window = &stage.history[stage.position];
+            double output = mTaps[centre] * window[centre];
+            for (int n = 1; n < centre; n += 2)
+            {
+                output += mTaps[centre - n] * (window[centre - n] + window[centre + n]);
+            }
+            samples[numOutput++] = output;
+        }
+        return numOutput;
+    }
+
+    double mTaps[PreDecimatorTaps];
+    Stage mStages[PreDecimatorMaxStages];
+    int mNumStages{ 0 };
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+#if !defined(CQT_REALTIME_CHECKS)
+#define CQT_REALTIME_CHECKS 0
+#endif
+
+#if CQT_REALTIME_CHECKS && (defined(__linux__) || defined(__APPLE__))
+#include <execinfo.h>
+#include <unistd.h>
+#endif
+
+constexpr int RealtimeMaxTraces{ 16 };
+constexpr int RealtimeTraceDepth{ 32 };
+
+enum RealtimeViolation
+{
+    kRealtimeAllocation = 0,
+    kRealtimeLock,
+    kRealtimeViolationNumber
+};
+
+/*
+Debug instrumentation for real-time safety.
+Code that must neither allocate nor block marks its thread with a ScopedRealtimeThread. Executables
+that link tools/RealtimeChecks.cpp intercept malloc, free and pthread_mutex_lock, and with them
+operator new/delete and std::mutex, and report every call on a marked thread here. The first
+RealtimeMaxTraces violations keep their stack trace.
+Without CQT_REALTIME_CHECKS, which debug builds define, marking a thread costs nothing.
+*/
+class RealtimeChecks
+{
+public:
+    class ScopedRealtimeThread
+    {
+    public:
+        ScopedRealtimeThread()
+        {
+#if CQT_REALTIME_CHECKS
+            sDepth++;
+#endif
+        }
+
+        ~ScopedRealtimeThread()
+        {
+#if CQT_REALTIME_CHECKS
+            sDepth--;
+#endif
+        }
+
+        ScopedRealtimeThread(const ScopedRealtimeThread&) = delete;
+        ScopedRealtimeThread& operator=(const ScopedRealtimeThread&) = delete;
+    };
+
+    static constexpr bool isEnabled()
+    {
+        return CQT_REALTIME_CHECKS != 0;
+    }
+
+    static bool isRealtimeThread()
+    {
+        return sDepth > 0 && sSuspended == 0;
+    }
+
+    // called by the interceptors
+    static void check(const RealtimeViolation type)
+    {
+        if (!isRealtimeThread())
+            return;
+        // recording may allocate itself, don't report that
+        sSuspended++;
+        sCounts[type].fetch_add(1, std::memory_order_relaxed);
+        const int index = sNumTraces.fetch_add(1, std::memory_order_relaxed);
+        if (index < RealtimeMaxTraces)
+        {
+            auto& trace = sTraces[index];
+            trace.type = type;
+#if CQT_REALTIME_CHECKS && (defined(__linux__) || defined(__APPLE__))
+            trace.depth = ::backtrace(trace.frames, RealtimeTraceDepth);
+#endif
+        }
+        sSuspended--;
+    }
+
+    static uint64_t getNumViolations()
+    {
+        uint64_t count = 0;
+        for (int type = 0; type < kRealtimeViolationNumber; type++)
+        {
+            count += sCounts[type].load();
+        }
+        return count;
+    }
+
+    static uint64_t getNumViolations(const RealtimeViolation type)
+    {
+        return sCounts[type].load();
+    }
+
+    // prints the counts and the recorded stack traces, without allocating
+    static void printReport(FILE* file)
+    {
+        std::fprintf(file, "real-time violations: %llu allocations, %llu locks\n",
+            static_cast<unsigned long long>(getNumViolations(kRealtimeAllocation)),
+            static_cast<unsigned long long>(getNumViolations(kRealtimeLock)));
+        const int numTraces = sNumTraces.load() < RealtimeMaxTraces ? sNumTraces.load() : RealtimeMaxTraces;
+        for (int i = 0; i < numTraces; i++)
+        {
+            std::fprintf(file, "#%d %s\n", i, sTraces[i].type == kRealtimeAllocation ? "allocation" : "lock");
+#if CQT_REALTIME_CHECKS && (defined(__linux__) || defined(__APPLE__))
+            std::fflush(file);
+            ::backtrace_symbols_fd(sTraces[i].frames, sTraces[i].depth, ::fileno(file));
+#endif
+        }
+    }
+
+private:
+    struct Trace
+    {
+        RealtimeViolation type;
+        int depth;
+        void* frames[RealtimeTraceDepth];
+    };
+
+    static inline thread_local int sDepth{ 0 };
+    static inline thread_local int sSuspended{ 0 };
+    static inline std::atomic<uint64_t> sCounts[kRealtimeViolationNumber]{};
+    static inline std::atomic<int> sNumTraces{ 0 };
+    static inline Trace sTraces[RealtimeMaxTraces]{};
+};
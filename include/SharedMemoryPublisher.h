@@ -0,0 +1,248 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/*
+Fixed, versioned layout of the shared-memory frame ring.
+A region consists of one SharedFrameHeader followed by numSlots slots of slotBytes each.
+Every slot starts with a SharedFrameSlot, followed by binsPerOctave doubles. For magnitude slots these
+are the octave's magnitudes, frequency slots follow them with the measured frequency of each bin, onset
+slots only use the first value for the onset strength and key/chord slots the first four values for
+key index, chord index, key confidence and chord confidence. Chroma slots hold the 12 normalized chroma
+values starting at C, octave magnitude slots the mean magnitude of each octave, octave 0 first.
+Slots are guarded by a sequence number: odd while being written, even when complete.
+Readers read a slot in place and accept it if the sequence number is even and unchanged after
+reading. The writer never waits on any reader. A writer lapping a slot another writer is still
+filling drops its frame, readers see that frame as lost once a later lap completes the slot. The only field readers write is readerHeartbeat, a
+std::chrono::steady_clock time in milliseconds they refresh regularly, so the writer can tell whether
+anybody is listening.
+*/
+constexpr uint32_t SharedFrameMagic{ 0x43515446 }; // "CQTF"
+constexpr uint32_t SharedFrameVersion{ 7 };
+constexpr uint32_t SharedFrameSlots{ 256 };
+
+struct SharedFrameHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t binsPerOctave;
+    uint32_t octaveNumber;
+    uint32_t numSlots;
+    uint32_t slotBytes;
+    double sampleRate;
+    std::atomic<uint64_t> writeIndex;
+    std::atomic<uint64_t> readerHeartbeat;
+    uint8_t reserved[16];
+};
+static_assert(sizeof(SharedFrameHeader) == 64, "SharedFrameHeader layout changed");
+
+enum SharedFrameType : uint32_t
+{
+    kSharedFrameMagnitudes = 0,
+    kSharedFrameOnset,
+    kSharedFrameKeyChord,
+    kSharedFrameFrequencies,
+    kSharedFrameChroma,
+    kSharedFrameOctaveMagnitudes
+};
+
+struct SharedFrameSlot
+{
+    std::atomic<uint64_t> sequence;
+    uint64_t frameIndex;
+    uint64_t samplePosition;
+    uint64_t centrePosition; // sample the octave's analysis window is centred on
+    uint32_t octave;
+    uint32_t type;
+};
+static_assert(sizeof(SharedFrameSlot) == 40, "SharedFrameSlot layout changed");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared ring needs lock free 64 bit atomics");
+
+inline size_t sharedFrameSlotBytes(const uint32_t binsPerOctave)
+{
+    return sizeof(SharedFrameSlot) + binsPerOctave * sizeof(double);
+}
+
+inline size_t sharedFrameRegionBytes(const uint32_t binsPerOctave, const uint32_t numSlots)
+{
+    return sizeof(SharedFrameHeader) + numSlots * sharedFrameSlotBytes(binsPerOctave);
+}
+
+/*
+Publishes octave frames into a POSIX shared-memory ring.
+publish() may be called concurrently from all octave threads, each call claims its own slot.
+*/
+template <int B, int OctaveNumber>
+class SharedMemoryPublisher
+{
+public:
+    SharedMemoryPublisher() = default;
+    ~SharedMemoryPublisher()
+    {
+        close();
+    }
+
+    bool open(const std::string& name, const double sampleRate)
+    {
+        close();
+#if defined(_WIN32)
+        (void)name; (void)sampleRate;
+        return false;
+#else
+        const size_t regionBytes = sharedFrameRegionBytes(B, SharedFrameSlots);
+        const int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            return false;
+        if (::ftruncate(fd, static_cast<off_t>(regionBytes)) != 0)
+        {
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            return false;
+        }
+        void* mapped = ::mmap(nullptr, regionBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED)
+        {
+            ::shm_unlink(name.c_str());
+            return false;
+        }
+        mName = name;
+        mRegion = static_cast<uint8_t*>(mapped);
+        mRegionBytes = regionBytes;
+
+        auto* header = getHeader();
+        header->binsPerOctave = B;
+        header->octaveNumber = OctaveNumber;
+        header->numSlots = SharedFrameSlots;
+        header->slotBytes = static_cast<uint32_t>(sharedFrameSlotBytes(B));
+        header->sampleRate = sampleRate;
+        header->writeIndex.store(0, std::memory_order_relaxed);
+        header->readerHeartbeat.store(0, std::memory_order_relaxed);
+        header->version = SharedFrameVersion;
+        // magic last, readers treat the region as valid only once it is set
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = SharedFrameMagic;
+        return true;
+#endif
+    }
+
+    void close()
+    {
+#if !defined(_WIN32)
+        if (mRegion != nullptr)
+        {
+            ::munmap(mRegion, mRegionBytes);
+            ::shm_unlink(mName.c_str());
+        }
+#endif
+        mRegion = nullptr;
+        mRegionBytes = 0;
+        mName.clear();
+    }
+
+    bool isOpen() const
+    {
+        return mRegion != nullptr;
+    }
+
+    const std::string& getName() const
+    {
+        return mName;
+    }
+
+    bool hasReader(const std::chrono::milliseconds maxAge) const
+    {
+        if (!isOpen())
+            return false;
+        const uint64_t heartbeat = reinterpret_cast<const SharedFrameHeader*>(mRegion)->readerHeartbeat.load(std::memory_order_relaxed);
+        const auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch());
+        return heartbeat != 0 && static_cast<int64_t>(now.count()) - static_cast<int64_t>(heartbeat) <= maxAge.count();
+    }
+
+    void setSampleRate(const double sampleRate)
+    {
+        if (isOpen())
+            getHeader()->sampleRate = sampleRate;
+    }
+
+    void publish(const int octave, const uint64_t samplePosition, const uint64_t centrePosition, const double* magnitudes)
+    {
+        write(kSharedFrameMagnitudes, octave, samplePosition, centrePosition, magnitudes, B);
+    }
+
+    void publishFrequencies(const int octave, const uint64_t samplePosition, const uint64_t centrePosition, const double* frequencies)
+    {
+        write(kSharedFrameFrequencies, octave, samplePosition, centrePosition, frequencies, B);
+    }
+
+    void publishOnset(const int octave, const uint64_t samplePosition, const uint64_t centrePosition, const double strength)
+    {
+        write(kSharedFrameOnset, octave, samplePosition, centrePosition, &strength, 1);
+    }
+
+    void publishKeyChord(const uint64_t samplePosition, const int key, const int chord, const double keyConfidence, const double chordConfidence)
+    {
+        const double values[4] = { static_cast<double>(key), static_cast<double>(chord), keyConfidence, chordConfidence };
+        write(kSharedFrameKeyChord, 0, samplePosition, samplePosition, values, 4);
+    }
+
+    void publishFeatures(const uint64_t samplePosition, const double* chroma, const int numChroma, const double* octaveMagnitudes)
+    {
+        static_assert(OctaveNumber <= B, "octave magnitudes must fit into a slot");
+        write(kSharedFrameChroma, 0, samplePosition, samplePosition, chroma, std::min(numChroma, B));
+        write(kSharedFrameOctaveMagnitudes, 0, samplePosition, samplePosition, octaveMagnitudes, OctaveNumber);
+    }
+
+private:
+    void write(const SharedFrameType type, const int octave, const uint64_t samplePosition, const uint64_t centrePosition, const double* values, const int numValues)
+    {
+        if (!isOpen())
+            return;
+        auto* header = getHeader();
+        const uint64_t frameIndex = header->writeIndex.fetch_add(1, std::memory_order_relaxed);
+        auto* slot = getSlot(frameIndex % SharedFrameSlots);
+
+        // seqlock write: odd while writing, even when done. The claim only succeeds on a complete slot
+        // of an earlier lap, a writer still busy with it keeps it and this frame is dropped.
+        const uint64_t sequence = 2 * (frameIndex / SharedFrameSlots) + 1;
+        uint64_t previous = slot->sequence.load(std::memory_order_relaxed);
+        do
+        {
+            if ((previous & 1) || previous >= sequence)
+                return;
+        } while (!slot->sequence.compare_exchange_weak(previous, sequence, std::memory_order_relaxed));
+        std::atomic_thread_fence(std::memory_order_release);
+        slot->frameIndex = frameIndex;
+        slot->samplePosition = samplePosition;
+        slot->centrePosition = centrePosition;
+        slot->octave = static_cast<uint32_t>(octave);
+        slot->type = type;
+        std::memcpy(reinterpret_cast<uint8_t*>(slot) + sizeof(SharedFrameSlot), values, numValues * sizeof(double));
+        slot->sequence.store(sequence + 1, std::memory_order_release);
+    }
+
+    SharedFrameHeader* getHeader()
+    {
+        return reinterpret_cast<SharedFrameHeader*>(mRegion);
+    }
+
+    SharedFrameSlot* getSlot(const uint64_t index)
+    {
+        return reinterpret_cast<SharedFrameSlot*>(mRegion + sizeof(SharedFrameHeader) + index * sharedFrameSlotBytes(B));
+    }
+
+    std::string mName;
+    uint8_t* mRegion{ nullptr };
+    size_t mRegionBytes{ 0 };
+};
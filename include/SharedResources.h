@@ -0,0 +1,289 @@
+#pragma once
+
+#include "ThreadPolicy.h"
+#include "TimerMt.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+Process-wide, reference-counted registry of resources keyed by their configuration.
+acquire() hands out the live resource for a key or builds it with the factory. The registry only keeps
+weak references, a resource dies with its last user, so memory grows with the number of distinct
+configurations in use and not with the number of plugin instances.
+It holds the clocks and the worker pool. The cqt kernels, FFT setups and window tables are built inside
+each engine's rt-cqt transform, which offers no way to hand them in, so they remain per instance.
+*/
+template <typename Key, typename Resource>
+class SharedResourceRegistry
+{
+public:
+    static SharedResourceRegistry& getInstance()
+    {
+        static SharedResourceRegistry registry;
+        return registry;
+    }
+
+    template <typename Factory>
+    std::shared_ptr<Resource> acquire(const Key& key, Factory&& factory)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mResources.find(key);
+        if (it != mResources.end())
+        {
+            if (auto resource = it->second.lock())
+                return resource;
+        }
+        // forget expired entries while we are at it
+        for (auto e = mResources.begin(); e != mResources.end();)
+        {
+            e = e->second.expired() ? mResources.erase(e) : std::next(e);
+        }
+        std::shared_ptr<Resource> resource = factory();
+        mResources[key] = resource;
+        return resource;
+    }
+
+    size_t getNumResources() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        size_t count = 0;
+        for (const auto& e : mResources)
+        {
+            if (!e.second.expired())
+                count++;
+        }
+        return count;
+    }
+
+private:
+    SharedResourceRegistry() = default;
+
+    mutable std::mutex mMutex;
+    std::map<Key, std::weak_ptr<Resource>> mResources;
+};
+
+constexpr unsigned WorkerPoolMaxThreads{ 16 };
+
+/*
+Process-wide pool of analysis workers, sized to the machine and capped at WorkerPoolMaxThreads.
+Tasks run concurrently on whichever worker is free, each worker follows the ThreadPolicy.
+*/
+class WorkerPool
+{
+public:
+    WorkerPool()
+    {
+        const unsigned numThreads = std::clamp(std::thread::hardware_concurrency(), 2u, WorkerPoolMaxThreads);
+        for (unsigned i = 0; i < numThreads; i++)
+        {
+            mThreads.emplace_back(&WorkerPool::run, this);
+        }
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopping = true;
+        }
+        mWake.notify_all();
+        for (auto& thread : mThreads)
+        {
+            thread.join();
+        }
+    }
+
+    void post(std::function<void(void)> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTasks.push_back(std::move(task));
+        }
+        mWake.notify_one();
+    }
+
+    size_t getNumThreads() const
+    {
+        return mThreads.size();
+    }
+
+private:
+    void run()
+    {
+        uint64_t policyGeneration = 0;
+        for (;;)
+        {
+            std::function<void(void)> task;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mWake.wait(lock, [this] { return mStopping || !mTasks.empty(); });
+                if (mTasks.empty())
+                    return;
+                task = std::move(mTasks.front());
+                mTasks.pop_front();
+            }
+            ThreadPolicy::getInstance().applyToCurrentThread(policyGeneration);
+            task();
+        }
+    }
+
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::deque<std::function<void(void)>> mTasks;
+    bool mStopping{ false };
+    std::vector<std::thread> mThreads;
+};
+
+/*
+One periodic thread shared by everyone asking for the same interval.
+On every tick the clock hands each subscriber to the WorkerPool, so the subscribers of all instances
+run in parallel and the clock's lock is never held during a callback. A subscriber whose previous
+call is still running skips the tick, so one subscriber never runs concurrently with itself.
+unsubscribe() only waits for a running call of that subscriber.
+*/
+class SharedClock
+{
+public:
+    explicit SharedClock(const std::chrono::milliseconds interval)
+        : mPool(SharedResourceRegistry<int, WorkerPool>::getInstance().acquire(0, []
+        {
+            return std::make_shared<WorkerPool>();
+        })),
+        mTimer(std::bind(&SharedClock::tick, this), interval, false)
+    {
+        mTimer.start(true);
+    }
+
+    ~SharedClock()
+    {
+        mTimer.stop();
+        // calls posted by the last tick may still be queued
+        std::unique_lock<std::mutex> lock(mMutex);
+        mIdle.wait(lock, [this] { return mNumRunning == 0; });
+    }
+
+    int subscribe(std::function<void(void)> callback)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        const int id = mNextId++;
+        auto subscriber = std::make_shared<Subscriber>();
+        subscriber->id = id;
+        subscriber->callback = std::move(callback);
+        mSubscribers.push_back(std::move(subscriber));
+        return id;
+    }
+
+    void unsubscribe(const int id)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        for (auto it = mSubscribers.begin(); it != mSubscribers.end(); it++)
+        {
+            if ((*it)->id == id)
+            {
+                const auto subscriber = *it;
+                mSubscribers.erase(it);
+                mIdle.wait(lock, [&subscriber] { return !subscriber->running; });
+                break;
+            }
+        }
+    }
+
+    const std::chrono::milliseconds& interval() const
+    {
+        return mTimer.interval();
+    }
+
+private:
+    struct Subscriber
+    {
+        int id{ -1 };
+        std::function<void(void)> callback;
+        // guarded by mMutex
+        bool running{ false };
+    };
+
+    void tick()
+    {
+        ThreadPolicy::getInstance().applyToCurrentThread(mPolicyGeneration);
+        // dispatching under the lock keeps unsubscribe() from missing a call that is about to start
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto& subscriber : mSubscribers)
+        {
+            if (subscriber->running)
+                continue;
+            subscriber->running = true;
+            mNumRunning++;
+            mPool->post([this, subscriber]
+            {
+                subscriber->callback();
+                // notified under the lock, the clock may be destroyed as soon as it is released
+                std::lock_guard<std::mutex> doneLock(mMutex);
+                subscriber->running = false;
+                mNumRunning--;
+                mIdle.notify_all();
+            });
+        }
+    }
+
+    std::shared_ptr<WorkerPool> mPool;
+    std::mutex mMutex;
+    std::condition_variable mIdle;
+    std::vector<std::shared_ptr<Subscriber>> mSubscribers;
+    int mNumRunning{ 0 };
+    int mNextId{ 0 };
+    uint64_t mPolicyGeneration{ 0 };
+    TimerMt mTimer;
+};
+
+/*
+A callback attached to the shared clock of its interval, detached on destruction.
+*/
+class SharedClockSubscription
+{
+public:
+    SharedClockSubscription() = default;
+    SharedClockSubscription(const SharedClockSubscription&) = delete;
+    SharedClockSubscription& operator=(const SharedClockSubscription&) = delete;
+
+    ~SharedClockSubscription()
+    {
+        detach();
+    }
+
+    void attach(const std::chrono::milliseconds interval, std::function<void(void)> callback)
+    {
+        detach();
+        mClock = SharedResourceRegistry<std::chrono::milliseconds::rep, SharedClock>::getInstance().acquire(interval.count(), [interval]
+        {
+            return std::make_shared<SharedClock>(interval);
+        });
+        mId = mClock->subscribe(std::move(callback));
+    }
+
+    void detach()
+    {
+        if (mClock != nullptr)
+            mClock->unsubscribe(mId);
+        // the last subscription of an interval stops its thread here
+        mClock.reset();
+        mId = -1;
+    }
+
+    bool isAttached() const
+    {
+        return mClock != nullptr;
+    }
+
+private:
+    std::shared_ptr<SharedClock> mClock;
+    int mId{ -1 };
+};
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+
+constexpr int SnapshotMaxSlots{ 512 };
+
+enum class SnapshotResolution
+{
+    Beat,
+    Bar
+};
+
+/*
+Average spectrum of every beat or bar of the host's timeline, e.g. to compare two choruses.
+The audio thread only hands over the transport of each block. The octave threads map the window
+centre of their frames to a musical position through it and add the frame to the snapshot of that
+beat or bar, so all the averaging happens on the analysis side.
+Snapshot n covers [n, n + 1) beats or bars from ppq 0, assuming the time signature stays the same.
+The store is preallocated with SnapshotMaxSlots entries, snapshot n lives in slot n % SnapshotMaxSlots.
+Every start of playback and every jump of the transport begins a new pass, and a snapshot restarts
+its average when the first frame of a new pass reaches it, so it describes the latest time it was played.
+Changing the resolution discards all snapshots.
+Each slot and octave is guarded by a sequence number, odd while a frame is being added. Octave threads
+only write their own octave, readers never block them and retry on a torn read.
+*/
+template <int B, int OctaveNumber>
+class SpectralSnapshots
+{
+public:
+    SpectralSnapshots()
+        : mSlots(new OctaveSnapshot[static_cast<size_t>(SnapshotMaxSlots) * OctaveNumber])
+    {
+    }
+
+    // message thread, discards the snapshots taken at the previous resolution
+    void setResolution(const SnapshotResolution resolution)
+    {
+        if (resolution == mResolution.load())
+            return;
+        mResolution.store(resolution);
+        mEpoch.fetch_add(1);
+        mLastIndex.store(-1);
+        mResetRequests.fetch_add(1);
+    }
+
+    SnapshotResolution getResolution() const
+    {
+        return mResolution.load();
+    }
+
+    // restarts pass detection, from prepare
+    void reset()
+    {
+        mResetRequests.fetch_add(1);
+        mPlaying = false;
+    }
+
+    /*
+    Transport at the start of a block, audio thread only. samplePosition counts the input samples
+    pushed before the block at sampleRate.
+    */
+    void setTransport(const bool playing, const double ppq, const double bpm, const int numerator, const int denominator,
+        const uint64_t samplePosition, const double sampleRate)
+    {
+        const double ppqPerSample = bpm / (60. * sampleRate);
+        const int resetRequests = mResetRequests.load(std::memory_order_relaxed);
+        // a transport that does not continue where the previous block left it jumped
+        const double expectedPpq = mPreviousPpq + static_cast<double>(samplePosition - mPreviousSamplePosition) * mPreviousPpqPerSample;
+        const bool jumped = std::abs(ppq - expectedPpq) > JumpTolerancePpq;
+        if (playing && (!mPlaying || jumped || resetRequests != mSeenResetRequests))
+        {
+            mSeenResetRequests = resetRequests;
+            mPass++;
+            mPassStartSample = samplePosition;
+        }
+        mPlaying = playing;
+        mPreviousPpq = ppq;
+        mPreviousPpqPerSample = ppqPerSample;
+        mPreviousSamplePosition = samplePosition;
+
+        const double beatPpq = 4. / static_cast<double>(std::max(1, denominator));
+        const double unitPpq = mResolution.load(std::memory_order_relaxed) == SnapshotResolution::Bar
+            ? beatPpq * static_cast<double>(std::max(1, numerator)) : beatPpq;
+        const uint64_t sequence = mAnchorSequence.load(std::memory_order_relaxed);
+        mAnchorSequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        mAnchor.playing.store(playing && ppqPerSample > 0., std::memory_order_relaxed);
+        mAnchor.samplePosition.store(samplePosition, std::memory_order_relaxed);
+        mAnchor.passStartSample.store(mPassStartSample, std::memory_order_relaxed);
+        mAnchor.pass.store(mPass, std::memory_order_relaxed);
+        mAnchor.epoch.store(mEpoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        mAnchor.ppq.store(ppq, std::memory_order_relaxed);
+        mAnchor.ppqPerSample.store(ppqPerSample, std::memory_order_relaxed);
+        mAnchor.unitPpq.store(unitPpq, std::memory_order_relaxed);
+        mAnchorSequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // octave threads, adds a frame whose window is centred on input sample centre
+    void add(const int octave, const uint64_t centre, const double* magnitudes)
+    {
+        Anchor anchor;
+        readAnchor(anchor);
+        // frames reaching back before the pass started belong to whatever played then
+        if (!anchor.playing || centre < anchor.passStartSample)
+            return;
+        const double ppq = anchor.ppq + (static_cast<double>(centre) - static_cast<double>(anchor.samplePosition)) * anchor.ppqPerSample;
+        if (ppq < 0.)
+            return;
+        const int64_t index = static_cast<int64_t>(std::floor(ppq / anchor.unitPpq));
+        OctaveSnapshot& snapshot = getSnapshot(index, octave);
+
+        const uint64_t sequence = snapshot.sequence.load(std::memory_order_relaxed);
+        snapshot.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        const bool restart = snapshot.index.load(std::memory_order_relaxed) != index
+            || snapshot.pass.load(std::memory_order_relaxed) != anchor.pass
+            || snapshot.epoch.load(std::memory_order_relaxed) != anchor.epoch;
+        for (int tone = 0; tone < B; tone++)
+        {
+            const double sum = restart ? 0. : snapshot.sums[tone].load(std::memory_order_relaxed);
+            snapshot.sums[tone].store(sum + magnitudes[tone], std::memory_order_relaxed);
+        }
+        snapshot.count.store(restart ? 1 : snapshot.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        snapshot.index.store(index, std::memory_order_relaxed);
+        snapshot.pass.store(anchor.pass, std::memory_order_relaxed);
+        snapshot.epoch.store(anchor.epoch, std::memory_order_relaxed);
+        snapshot.sequence.store(sequence + 2, std::memory_order_release);
+
+        int64_t lastIndex = mLastIndex.load(std::memory_order_relaxed);
+        while (index > lastIndex && !mLastIndex.compare_exchange_weak(lastIndex, index, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    /*
+    Average magnitudes of snapshot index. Octaves without frames in it are zero, returns false if
+    no octave has any or the slot has been taken over by a later snapshot.
+    */
+    bool read(const int64_t index, double frame[OctaveNumber][B]) const
+    {
+        if (index < 0)
+            return false;
+        const uint64_t epoch = mEpoch.load(std::memory_order_relaxed);
+        bool found = false;
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            const OctaveSnapshot& snapshot = getSnapshot(index, o);
+            for (;;)
+            {
+                const uint64_t sequence = snapshot.sequence.load(std::memory_order_acquire);
+                if (sequence & 1)
+                    continue;
+                const uint32_t count = snapshot.count.load(std::memory_order_relaxed);
+                const bool valid = count > 0 && snapshot.index.load(std::memory_order_relaxed) == index
+                    && snapshot.epoch.load(std::memory_order_relaxed) == epoch;
+                const double scale = valid ? 1. / static_cast<double>(count) : 0.;
+                for (int tone = 0; tone < B; tone++)
+                {
+                    frame[o][tone] = snapshot.sums[tone].load(std::memory_order_relaxed) * scale;
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (snapshot.sequence.load(std::memory_order_relaxed) == sequence)
+                {
+                    found = found || valid;
+                    break;
+                }
+            }
+        }
+        return found;
+    }
+
+    // highest snapshot captured so far, -1 if none
+    int64_t getLastIndex() const
+    {
+        return mLastIndex.load(std::memory_order_relaxed);
+    }
+
+    size_t getBytes() const
+    {
+        return static_cast<size_t>(SnapshotMaxSlots) * OctaveNumber * sizeof(OctaveSnapshot);
+    }
+
+private:
+    // transport jumps smaller than this are taken as rounding of the host
+    static constexpr double JumpTolerancePpq{ 0.01 };
+
+    struct Anchor
+    {
+        bool playing{ false };
+        uint64_t samplePosition{ 0 };
+        uint64_t passStartSample{ 0 };
+        uint64_t pass{ 0 };
+        uint64_t epoch{ 0 };
+        double ppq{ 0. };
+        double ppqPerSample{ 0. };
+        double unitPpq{ 1. };
+    };
+
+    struct SharedAnchor
+    {
+        std::atomic<bool> playing{ false };
+        std::atomic<uint64_t> samplePosition{ 0 };
+        std::atomic<uint64_t> passStartSample{ 0 };
+        std::atomic<uint64_t> pass{ 0 };
+        std::atomic<uint64_t> epoch{ 0 };
+        std::atomic<double> ppq{ 0. };
+        std::atomic<double> ppqPerSample{ 0. };
+        std::atomic<double> unitPpq{ 1. };
+    };
+
+    struct OctaveSnapshot
+    {
+        std::atomic<uint64_t> sequence{ 0 };
+        std::atomic<int64_t> index{ -1 };
+        std::atomic<uint64_t> pass{ 0 };
+        std::atomic<uint64_t> epoch{ 0 };
+        std::atomic<uint32_t> count{ 0 };
+        std::atomic<double> sums[B] = {};
+    };
+
+    void readAnchor(Anchor& anchor) const
+    {
+        for (;;)
+        {
+            const uint64_t sequence = mAnchorSequence.load(std::memory_order_acquire);
+            if (sequence & 1)
+                continue;
+            anchor.playing = mAnchor.playing.load(std::memory_order_relaxed);
+            anchor.samplePosition = mAnchor.samplePosition.load(std::memory_order_relaxed);
+            anchor.passStartSample = mAnchor.passStartSample.load(std::memory_order_relaxed);
+            anchor.pass = mAnchor.pass.load(std::memory_order_relaxed);
+            anchor.epoch = mAnchor.epoch.load(std::memory_order_relaxed);
+            anchor.ppq = mAnchor.ppq.load(std::memory_order_relaxed);
+            anchor.ppqPerSample = mAnchor.ppqPerSample.load(std::memory_order_relaxed);
+            anchor.unitPpq = mAnchor.unitPpq.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (mAnchorSequence.load(std::memory_order_relaxed) == sequence)
+                return;
+        }
+    }
+
+    OctaveSnapshot& getSnapshot(const int64_t index, const int octave) const
+    {
+        const size_t slot = static_cast<size_t>(index % SnapshotMaxSlots);
+        return mSlots[slot * OctaveNumber + static_cast<size_t>(octave)];
+    }
+
+    std::unique_ptr<OctaveSnapshot[]> mSlots;
+    std::atomic<int64_t> mLastIndex{ -1 };
+    std::atomic<SnapshotResolution> mResolution{ SnapshotResolution::Bar };
+    std::atomic<uint64_t> mEpoch{ 0 };
+    std::atomic<int> mResetRequests{ 0 };
+
+    // audio thread
+    bool mPlaying{ false };
+    int mSeenResetRequests{ 0 };
+    double mPreviousPpq{ 0. };
+    double mPreviousPpqPerSample{ 0. };
+    uint64_t mPreviousSamplePosition{ 0 };
+    uint64_t mPassStartSample{ 0 };
+    uint64_t mPass{ 0 };
+
+    std::atomic<uint64_t> mAnchorSequence{ 0 };
+    SharedAnchor mAnchor;
+};
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+constexpr int PolicyMaxCpus{ 256 };
+
+/*
+Scheduling policy of the analysis worker threads.
+The settings come from a config file with "key = value" lines, by default
+$HOME/.config/CqtAnalyzer/workers.conf or the file named by CQT_WORKER_CONFIG, and are overridden
+by the environment:
+    nice                CQT_WORKER_NICE                 nice level under SCHED_OTHER
+    fifo_priority       CQT_WORKER_FIFO_PRIORITY        SCHED_FIFO priority, 0 keeps SCHED_OTHER
+    cpus                CQT_WORKER_CPUS                 allowed cpus, e.g. "2-5,8", empty for all
+    avoid_audio_cores   CQT_WORKER_AVOID_AUDIO_CORES    1 keeps workers off cores the audio thread ran on
+Workers apply the policy to themselves, the audio thread reports the cores it runs on via
+noteAudioThread(). SCHED_FIFO workers are kept below the observed audio thread priority.
+Only Linux applies anything, elsewhere the policy is reported as the default.
+*/
+class ThreadPolicy
+{
+public:
+    static ThreadPolicy& getInstance()
+    {
+        static ThreadPolicy policy;
+        return policy;
+    }
+
+    // called on the audio thread, costs one vdso call unless the core is new
+    void noteAudioThread()
+    {
+#if defined(__linux__)
+        const int cpu = ::sched_getcpu();
+        if (cpu < 0 || cpu >= PolicyMaxCpus)
+            return;
+        const uint64_t bit = uint64_t{ 1 } << (cpu % 64);
+        auto& word = mAudioCpus[cpu / 64];
+        if ((word.load(std::memory_order_relaxed) & bit) != 0)
+            return;
+        word.fetch_or(bit, std::memory_order_relaxed);
+        int policy = 0;
+        sched_param param{};
+        if (::pthread_getschedparam(::pthread_self(), &policy, &param) == 0 && (policy == SCHED_FIFO || policy == SCHED_RR))
+            mAudioPriority.store(param.sched_priority, std::memory_order_relaxed);
+        mGeneration.fetch_add(1, std::memory_order_release);
+#endif
+    }
+
+    /*
+    Applies the policy to the calling thread if it changed since the thread last applied it.
+    appliedGeneration is the thread's own record, start it at 0.
+    */
+    void applyToCurrentThread(uint64_t& appliedGeneration)
+    {
+        const uint64_t generation = mGeneration.load(std::memory_order_acquire);
+        if (generation == appliedGeneration)
+            return;
+        appliedGeneration = generation;
+#if defined(__linux__)
+        std::ostringstream report;
+        const int audioPriority = mAudioPriority.load(std::memory_order_relaxed);
+        int fifoPriority = mFifoPriority;
+        if (fifoPriority > 0 && audioPriority > 0)
+            fifoPriority = std::min(fifoPriority, audioPriority - 1);
+        if (fifoPriority > 0)
+        {
+            sched_param param{};
+            param.sched_priority = fifoPriority;
+            if (::pthread_setschedparam(::pthread_self(), SCHED_FIFO, &param) != 0)
+                report << "SCHED_FIFO " << fifoPriority << " denied, ";
+        }
+        else
+        {
+            sched_param param{};
+            ::pthread_setschedparam(::pthread_self(), SCHED_OTHER, &param);
+            // the nice value is per thread on Linux
+            if (::setpriority(PRIO_PROCESS, static_cast<id_t>(::syscall(SYS_gettid)), mNice) != 0)
+                report << "nice " << mNice << " denied, ";
+        }
+
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        int numCpus = 0;
+        for (int cpu = 0; cpu < PolicyMaxCpus && cpu < CPU_SETSIZE; cpu++)
+        {
+            const bool allowed = mAllCpus || (mCpus[cpu / 64] & (uint64_t{ 1 } << (cpu % 64))) != 0;
+            const bool audio = (mAudioCpus[cpu / 64].load(std::memory_order_relaxed) & (uint64_t{ 1 } << (cpu % 64))) != 0;
+            if (allowed && !(mAvoidAudioCores && audio))
+            {
+                CPU_SET(cpu, &cpus);
+                numCpus++;
+            }
+        }
+        // never leave a worker without a core to run on
+        if (numCpus > 0 && ::pthread_setaffinity_np(::pthread_self(), sizeof(cpus), &cpus) != 0)
+            report << "affinity denied, ";
+
+        report << describeThread();
+        std::lock_guard<std::mutex> lock(mReportMutex);
+        mReport = report.str();
+#endif
+    }
+
+    // effective policy as last applied by a worker
+    std::string getReport() const
+    {
+        std::lock_guard<std::mutex> lock(mReportMutex);
+        return mReport;
+    }
+
+private:
+    ThreadPolicy()
+    {
+        const char* home = std::getenv("HOME");
+        const char* configPath = std::getenv("CQT_WORKER_CONFIG");
+        std::string path = configPath != nullptr ? configPath : (home != nullptr ? std::string(home) + "/.config/CqtAnalyzer/workers.conf" : "");
+        std::ifstream config(path);
+        std::string line;
+        while (std::getline(config, line))
+        {
+            line = line.substr(0, line.find('#'));
+            const auto separator = line.find('=');
+            if (separator == std::string::npos)
+                continue;
+            set(trim(line.substr(0, separator)), trim(line.substr(separator + 1)));
+        }
+        setFromEnvironment("nice", "CQT_WORKER_NICE");
+        setFromEnvironment("fifo_priority", "CQT_WORKER_FIFO_PRIORITY");
+        setFromEnvironment("cpus", "CQT_WORKER_CPUS");
+        setFromEnvironment("avoid_audio_cores", "CQT_WORKER_AVOID_AUDIO_CORES");
+        for (auto& word : mAudioCpus)
+        {
+            word.store(0);
+        }
+    }
+
+    static std::string trim(const std::string& s)
+    {
+        const auto first = s.find_first_not_of(" \t\r");
+        const auto last = s.find_last_not_of(" \t\r");
+        return first == std::string::npos ? "" : s.substr(first, last - first + 1);
+    }
+
+    void setFromEnvironment(const std::string& key, const char* variable)
+    {
+        if (const char* value = std::getenv(variable))
+            set(key, value);
+    }
+
+    void set(const std::string& key, const std::string& value)
+    {
+        if (key == "nice")
+            mNice = std::atoi(value.c_str());
+        else if (key == "fifo_priority")
+            mFifoPriority = std::max(0, std::atoi(value.c_str()));
+        else if (key == "avoid_audio_cores")
+            mAvoidAudioCores = std::atoi(value.c_str()) != 0;
+        else if (key == "cpus")
+            parseCpus(value);
+    }
+
+    // "2-5,8" style lists
+    void parseCpus(const std::string& list)
+    {
+        for (auto& word : mCpus)
+        {
+            word = 0;
+        }
+        mAllCpus = true;
+        std::istringstream ranges(list);
+        std::string range;
+        while (std::getline(ranges, range, ','))
+        {
+            range = trim(range);
+            if (range.empty())
+                continue;
+            const auto dash = range.find('-');
+            const int first = std::atoi(range.substr(0, dash).c_str());
+            const int last = dash == std::string::npos ? first : std::atoi(range.substr(dash + 1).c_str());
+            for (int cpu = std::max(0, first); cpu <= last && cpu < PolicyMaxCpus; cpu++)
+            {
+                mCpus[cpu / 64] |= uint64_t{ 1 } << (cpu % 64);
+                mAllCpus = false;
+            }
+        }
+    }
+
+#if defined(__linux__)
+    static std::string describeThread()
+    {
+        std::ostringstream description;
+        int policy = 0;
+        sched_param param{};
+        ::pthread_getschedparam(::pthread_self(), &policy, &param);
+        if (policy == SCHED_FIFO)
+            description << "SCHED_FIFO " << param.sched_priority;
+        else
+            description << "SCHED_OTHER nice " << ::getpriority(PRIO_PROCESS, static_cast<id_t>(::syscall(SYS_gettid)));
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        if (::pthread_getaffinity_np(::pthread_self(), sizeof(cpus), &cpus) == 0)
+        {
+            description << ", cpus";
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            {
+                if (CPU_ISSET(cpu, &cpus))
+                    description << " " << cpu;
+            }
+        }
+        return description.str();
+    }
+#endif
+
+    int mNice{ 0 };
+    int mFifoPriority{ 0 };
+    bool mAvoidAudioCores{ false };
+    bool mAllCpus{ true };
+    uint64_t mCpus[PolicyMaxCpus / 64] = {};
+
+    std::atomic<uint64_t> mAudioCpus[PolicyMaxCpus / 64];
+    std::atomic<int> mAudioPriority{ 0 };
+    // starts at 1 so every worker applies the configured policy once
+    std::atomic<uint64_t> mGeneration{ 1 };
+
+    mutable std::mutex mReportMutex;
+    std::string mReport{ "default" };
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+class ChromaFeatureComponent    : public juce::Component, public juce::Timer
+{
+public:
+    ChromaFeatureComponent(AudioPluginAudioProcessor& p):
+	processorRef (p)
+    {
+		for (int c = 0; c < ChromaBins; c++)
+		{
+			mChromaFeature[c] = 0.;
+		}
+		startTimer(15);
+    }
+
+    void paint (juce::Graphics& g) override
+    {
+		auto bounds = getLocalBounds().toFloat();
+		auto circleArea = bounds.withTrimmedBottom(0.08f * bounds.getHeight());
+		auto labelArea = bounds.withTrimmedTop(0.92f * bounds.getHeight());
+
+		g.setFont(14.f / static_cast<float>(PLUGIN_HEIGHT) * getParentHeight());
+		g.setColour(juce::Colours::white);
+		g.drawText("Note Distribution", labelArea, juce::Justification::centred);
+
+		// main empty black circle
+		const float r = 0.5f * std::min(circleArea.getWidth(), circleArea.getHeight());
+		const auto centre = circleArea.getCentre();
+		g.setColour(juce::Colours::black);
+		g.fillEllipse(juce::Rectangle<float>(2.f * r, 2.f * r).withCentre(centre));
+
+		// segment for each tone, cut value at 0.
+		const float arcAngleIncr = juce::MathConstants<float>::twoPi / static_cast<float>(ChromaBins);
+		const float colorFadeIncr = 1.f / static_cast<float>(ChromaBins);
+		float angle = 0.f;
+		for (int c = 0; c < ChromaBins; c++)
+		{
+			const float toneR = std::max(0.f, static_cast<float>(mChromaFeature[c])) * r;
+			juce::Path segment;
+			segment.addPieSegment(juce::Rectangle<float>(2.f * toneR, 2.f * toneR).withCentre(centre), angle, angle + arcAngleIncr, 0.f);
+			g.setColour(juce::Colour::fromHSL(static_cast<float>(c) * colorFadeIncr, 0.7f, 0.3f, 1.f));
+			g.fillPath(segment);
+			angle += arcAngleIncr;
+		}
+
+		// note letters
+		g.setColour(juce::Colours::white);
+		g.setFont(0.12f * r);
+		const float rText = 0.7f * r;
+		const float textSize = 0.3f * r;
+		angle = 0.5f * arcAngleIncr;
+		for (int c = 0; c < ChromaBins; c++)
+		{
+			const juce::Point<float> textCentre{ centre.x + rText * std::sin(angle), centre.y - rText * std::cos(angle) };
+			g.drawText(mNotes[c], juce::Rectangle<float>(textSize, textSize).withCentre(textCentre), juce::Justification::centred);
+			angle += arcAngleIncr;
+		}
+    }
+
+	void timerCallback() override
+	{
+		double chroma[ChromaBins];
+		processorRef.getFeatures().getChroma(chroma);
+		for (int c = 0; c < ChromaBins; c++)
+		{
+			mChromaFeature[c] = mChromaFeature[c] * 0.9 + 0.1 * chroma[c];
+		}
+		repaint();
+	}
+
+private:
+	AudioPluginAudioProcessor& processorRef;
+
+	double mChromaFeature[ChromaBins];
+	const juce::String mNotes[ChromaBins] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChromaFeatureComponent)
+};
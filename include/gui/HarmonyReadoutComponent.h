@@ -0,0 +1,38 @@
+#pragma once
+
+class HarmonyReadoutComponent    : public juce::Component, public juce::Timer
+{
+public:
+    HarmonyReadoutComponent(AudioPluginAudioProcessor& p):
+	processorRef (p)
+    {
+		startTimer(50);
+    }
+
+    void paint (juce::Graphics& g) override
+    {
+		auto bounds = getLocalBounds().toFloat();
+		auto keyRect = bounds.withTrimmedRight(0.4f * bounds.getWidth());
+		auto chordRect = bounds.withTrimmedLeft(0.6f * bounds.getWidth());
+
+		g.setFont(juce::Font(0.5f * bounds.getHeight(), juce::Font::bold));
+		g.setColour(juce::Colours::white.withAlpha(0.4f + 0.6f * static_cast<float>(mEstimate.keyConfidence)));
+		g.drawText(KeyChordEstimate::getKeyName(mEstimate.key), keyRect, juce::Justification::centred);
+		g.setColour(juce::Colours::white.withAlpha(0.4f + 0.6f * static_cast<float>(mEstimate.chordConfidence)));
+		g.drawText(KeyChordEstimate::getChordName(mEstimate.chord), chordRect, juce::Justification::centred);
+    }
+
+	void timerCallback() override
+	{
+		mEstimate = processorRef.getKeyChord();
+		repaint();
+	}
+
+private:
+	AudioPluginAudioProcessor& processorRef;
+
+	KeyChordEstimate mEstimate;
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HarmonyReadoutComponent)
+};
@@ -13,43 +13,44 @@ public:
 		valueRect = valueRect.withTrimmedTop(valueRect.getHeight() - mValue * valueRect.getHeight());
 		g.setColour(mColour);
 		g.fillRect(valueRect);
+		if (mCompareValue >= 0.)
+		{
+			auto bounds = getBounds().toFloat();
+			const float compareY = bounds.getBottom() - static_cast<float>(mCompareValue) * bounds.getHeight();
+			g.setColour(juce::Colours::white);
+			g.drawLine(bounds.getX(), compareY, bounds.getRight(), compareY, 1.5f);
+		}
     };
 
     void setColour(const juce::Colour colour){mColour = colour;};
 
+    // values arrive smoothed by the engine's ballistics
     void setValue(const double value) 
-	{
-		if(value > mValue)
-		{
-			mValue = (1. - mSmoothingUp) * value + mSmoothingUp * mValue;
-		}
-		else
-		{
-			mValue = (1. - mSmoothingDown) * value + mSmoothingDown * mValue;
-		}	
-	};
-
-	void setValueHard(const double value)
 	{
 		mValue = value;
-	}
+	};
 
-	const double& getValue()
+	// level of a second spectrum drawn as a line across the bar, negative hides it
+	void setCompareValue(const double value)
 	{
-		return mValue;
+		mCompareValue = value;
 	}
 
-	void setSmoothing(const double smoothingUp, const double smoothingDown)
+	juce::String getTooltip() override
 	{
-		const double smoothingUpClipped = Cqt::Clip<double>(smoothingUp, 0., 0.999999);
-		const double smoothingDownClipped = Cqt::Clip<double>(smoothingDown, 0., 0.999999);
-		mSmoothingUp = smoothingUpClipped;
-		mSmoothingDown = smoothingDownClipped;
+		if (mMeasuredFrequency <= 0.)
+			return mFrequencyString;
+		std::ostringstream streamObj;
+		streamObj << std::fixed;
+		streamObj << std::setprecision(2);
+		streamObj << mMeasuredFrequency;
+		return mFrequencyString + " (measured " + streamObj.str() + " Hz)";
 	}
 
-	juce::String getTooltip() override
+	// instantaneous frequency of the bin, 0 if not measured
+	void setMeasuredFrequency(const double frequency)
 	{
-		return mFrequencyString;
+		mMeasuredFrequency = frequency;
 	}
 
 	void setFrequency(const double frequency)
@@ -71,9 +72,9 @@ public:
 
 private:
     double mValue{ 0. };
-	double mSmoothingUp{ 0.7 };
-	double mSmoothingDown{ 0.85 };
+	double mCompareValue{ -1. };
 	double mFrequency{ 50. };
+	double mMeasuredFrequency{ 0. };
 	juce::String mFrequencyString{"50 Hz"};
     juce::Colour mColour;
 
@@ -82,9 +83,12 @@ private:
 };
 
 template <int B, int OctaveNumber>
-class MagnitudesComponent    : public juce::Component, public juce::Timer
+class MagnitudesComponent    : public juce::Component
 {
 public:
+	// rate the onset decay was tuned at
+	static constexpr double ReferenceFrameMs{ 15. };
+
     MagnitudesComponent(AudioPluginAudioProcessor& p):
 	processorRef (p)
     {
@@ -99,15 +103,8 @@ public:
 			}
 		}
 
-		// timer
-		startTimer(15);
     }
 
-	~MagnitudesComponent()
-	{
-		//stopTimer();
-	}
-
     void paint (juce::Graphics& g) override
     {
         g.fillAll (mBackgroundColor);
@@ -127,7 +124,7 @@ public:
 		for (int o = 0; o < OctaveNumber; o++)
 		{
             const int toneOffset = static_cast<int>(std::round(9.f / 12.f * static_cast<float>(B)));
-			const double freq = processorRef.mKernelFreqs[OctaveNumber - o - 1][toneOffset];
+			const double freq = processorRef.getEngine().mKernelFreqs[OctaveNumber - o - 1][toneOffset];
 			
 			std::string freqStr = "A" + std::to_string(o) + ": ";
 			if (freq < 1000.)
@@ -142,7 +139,8 @@ public:
 				streamObj << freq / 1000.;
 				freqStr += streamObj.str() + " kHz";
 			}
-            g.setColour(juce::Colours::white);
+            // octaves outside the analysed frequency range stay empty
+            g.setColour(processorRef.isOctaveActive(OctaveNumber - o - 1) ? juce::Colours::white : juce::Colours::grey);
 			g.drawText(juce::String(freqStr), labelRect, juce::Justification::centred);
 
             g.setColour(juce::Colour::fromHSV(static_cast<float>(o * B + toneOffset) * colorFadeIncr, 0.98, 0.725, 1.f));
@@ -190,6 +188,17 @@ public:
                 mMagnitudeMeters[octave][tone].paint(g);
 			}
 		}
+
+		// onset markers
+		for (int octave = 0; octave < OctaveNumber; octave++) 
+		{
+			if (mOnsetFlash[octave] < 0.01f)
+				continue;
+			const float left = static_cast<float>(mMagnitudeMeters[octave][0].getX());
+			const float right = static_cast<float>(mMagnitudeMeters[octave][B - 1].getRight());
+			g.setColour(juce::Colours::white.withAlpha(mOnsetFlash[octave]));
+			g.fillRect(left, bounds.getY(), right - left, 0.015f * bounds.getHeight());
+		}
     }
 
     void resized() override
@@ -210,66 +219,100 @@ public:
 		}
     }
 
-	void timerCallback() override
+	// once per display refresh, live frames are interpolated to the refresh time
+	void updateFrame()
 	{
+		const auto now = std::chrono::steady_clock::now();
+		double steps = 1.;
+		if (mLastFrameTime.time_since_epoch().count() != 0)
+		{
+			steps = std::chrono::duration<double, std::milli>(now - mLastFrameTime).count() / ReferenceFrameMs;
+			steps = Cqt::Clip<double>(steps, 0., 10.);
+		}
+		mLastFrameTime = now;
+
+		// live magnitudes, time aligned or each octave's newest frame, a frame scrubbed back from the history
+		// or the average of a beat or bar, optionally compared with another one
+		if (processorRef.isTimeAligned())
+			processorRef.getEngine().readAligned(mDisplayFrame);
+		else
+			processorRef.getEngine().readInterpolated(now, mDisplayFrame);
+		const double (*magnitudes)[B] = mDisplayFrame;
+		bool live = true;
+		if (mHistorySecondsAgo > 0. && processorRef.readHistory(mHistorySecondsAgo, mHistoryLevel, mHistoryFrame))
+		{
+			magnitudes = mHistoryFrame;
+			live = false;
+		}
+		if (mSnapshotIndex >= 0)
+		{
+			processorRef.readSnapshot(mSnapshotIndex, mHistoryFrame);
+			magnitudes = mHistoryFrame;
+			live = false;
+		}
+		const bool compare = mSnapshotIndex >= 0 && mCompareIndex >= 0 && mCompareIndex != mSnapshotIndex
+			&& processorRef.readSnapshot(mCompareIndex, mCompareFrame);
+		// measured frequencies only describe the live frames
+		const bool measured = live && processorRef.getEngine().isInstantaneousFrequencyEnabled();
+		if (measured)
+			processorRef.getEngine().readInstantaneousFreqs(mFrequencyFrame);
 		for (int octave = 0; octave < OctaveNumber; octave++) 
 		{
 			for (int tone = 0; tone < B; tone++) 
 			{
-				const double value = processorRef.mCqtDataStorage[octave][tone];
+				const double value = magnitudes[octave][tone];
 				double magLog = juce::Decibels::gainToDecibels(value);
 				magLog = Cqt::Clip<double>(magLog, mMagMin, mMagMax);
 				const double magLogMapped = 1. - ((mMagMax - magLog) * mOneDivMaxMin);
-				mMagnitudeMeters[OctaveNumber - octave - 1][tone].setValue(magLogMapped);
-			}
-		}
-		if(processorRef.mNewKernelFreqs)
-		{
-			for (int octave = 0; octave < OctaveNumber; octave++) 
-			{
-				for (int tone = 0; tone < B; tone++) 
+				auto& meter = mMagnitudeMeters[OctaveNumber - octave - 1][tone];
+				meter.setValue(magLogMapped);
+				meter.setMeasuredFrequency(measured && magLog > mMagMin ? mFrequencyFrame[octave][tone] : 0.);
+				double compareValue = -1.;
+				if (compare)
 				{
-					mMagnitudeMeters[OctaveNumber - octave - 1][tone].setFrequency(processorRef.mKernelFreqs[octave][tone]);
+					const double compareLog = Cqt::Clip<double>(juce::Decibels::gainToDecibels(mCompareFrame[octave][tone]), mMagMin, mMagMax);
+					compareValue = 1. - ((mMagMax - compareLog) * mOneDivMaxMin);
 				}
+				meter.setCompareValue(compareValue);
 			}
-			processorRef.mNewKernelFreqs = false;
 		}
-		repaint();
-	}
-
-	void remapValues()
-	{
+		// flash octaves with new onsets
+		const auto& onsets = processorRef.getOnsets();
+		const uint64_t numOnsets = onsets.getNumEvents();
+		if (numOnsets < mOnsetIndex)
+			mOnsetIndex = 0;
+		OnsetEvent onset;
+		for (uint64_t i = mOnsetIndex; i < numOnsets; i++)
+		{
+			if (onsets.getEvent(i, onset))
+				mOnsetFlash[OctaveNumber - onset.octave - 1] = 1.f;
+		}
+		mOnsetIndex = numOnsets;
 		for (int octave = 0; octave < OctaveNumber; octave++) 
 		{
-			for (int tone = 0; tone < B; tone++) 
+			mOnsetFlash[octave] *= static_cast<float>(std::pow(0.85, steps));
+		}
+
+		if(processorRef.getEngine().mNewKernelFreqs)
+		{
+			for (int octave = 0; octave < OctaveNumber; octave++) 
 			{
-				const double magLogMapped = mMagnitudeMeters[OctaveNumber - octave - 1][tone].getValue();
-				const double magLog = magLogMapped * (mMagMaxPrev - mMagMinPrev) + mMagMinPrev;
-				if((magLog > mMagMin) && (magLog < mMagMax) && (magLog > mMagMinPrev))
-				{
-					const double magLogRemapped = 1. - ((mMagMax - magLog) * mOneDivMaxMin);
-					mMagnitudeMeters[OctaveNumber - octave - 1][tone].setValueHard(magLogRemapped);
-				}
-				else if(magLog > mMagMax)
+				for (int tone = 0; tone < B; tone++) 
 				{
-					mMagnitudeMeters[OctaveNumber - octave - 1][tone].setValueHard(1.);
+					mMagnitudeMeters[OctaveNumber - octave - 1][tone].setFrequency(processorRef.getEngine().mKernelFreqs[octave][tone]);
 				}
-				else
-				{
-					mMagnitudeMeters[OctaveNumber - octave - 1][tone].setValueHard(0.);
-				}	
 			}
+			processorRef.getEngine().mNewKernelFreqs = false;
 		}
+		repaint();
 	}
 
 	void setRangeMin(const double rangeMin)
 	{
 		if(static_cast<int>(rangeMin) != static_cast<int>(mMagMax))
 		{
-			mMagMinPrev = mMagMin;
 			mMagMin = rangeMin;
 			mOneDivMaxMin = 1. / (mMagMax - mMagMin);
-			remapValues();
 			repaint();
 		}	
 	}
@@ -278,10 +321,8 @@ public:
 	{
 		if(static_cast<int>(rangeMax) != static_cast<int>(mMagMin))
 		{
-			mMagMaxPrev = mMagMax;
 			mMagMax = rangeMax;
 			mOneDivMaxMin = 1. / (mMagMax - mMagMin);
-			remapValues();
 			repaint();
 		}
 	}
@@ -292,29 +333,17 @@ public:
 		repaint();
 	}
 
-	void setSmoothing(const double smoothing)
+	void setHistoryView(const double secondsAgo, const int level)
 	{
-		const double smoothingClipped = Cqt::Clip<double>(smoothing, 0., 0.999999);
-		const double smoothingUp = smoothingClipped;
-		const double smoothingDown = (1. - (1. - smoothingClipped) * 0.5);
-		for (int octave = 0; octave < OctaveNumber; octave++) 
-		{
-			for (int tone = 0; tone < B; tone++) 
-			{
-				mMagnitudeMeters[octave][tone].setSmoothing(smoothingUp, smoothingDown);
-			}
-		}
+		mHistorySecondsAgo = secondsAgo;
+		mHistoryLevel = level;
 	}
 
-	void setSmoothing(const double smoothingUp, const double smoothingDown)
+	// shows the average of a beat or bar and compares it with another one, negative indices show live frames
+	void setSnapshotView(const int64_t snapshotIndex, const int64_t compareIndex)
 	{
-		for (int octave = 0; octave < OctaveNumber; octave++) 
-			{
-				for (int tone = 0; tone < B; tone++) 
-				{
-					mMagnitudeMeters[octave][tone].setSmoothing(smoothingUp, smoothingDown);
-				}
-			}
+		mSnapshotIndex = snapshotIndex;
+		mCompareIndex = compareIndex;
 	}
 private:
 	AudioPluginAudioProcessor& processorRef;
@@ -324,14 +353,26 @@ private:
 	MagnitudeMeter mMagnitudeMeters[OctaveNumber][B];
 	double mMagMin{ -50. };
 	double mMagMax{ 0. };
-	double mMagMinPrev{ -50. };
-	double mMagMaxPrev{ 0. };
 	double mTuning{ 440. };
 	double mOneDivMaxMin{ 1. };
+	double mHistorySecondsAgo{ 0. };
+	int mHistoryLevel{ 0 };
+	double mHistoryFrame[OctaveNumber][B];
+	double mDisplayFrame[OctaveNumber][B];
+	double mFrequencyFrame[OctaveNumber][B];
+	int64_t mSnapshotIndex{ -1 };
+	int64_t mCompareIndex{ -1 };
+	double mCompareFrame[OctaveNumber][B];
+	std::chrono::steady_clock::time_point mLastFrameTime;
+	uint64_t mOnsetIndex{ 0 };
+	float mOnsetFlash[OctaveNumber] = {};
 	const float mXAxisMargin{ 0.08f };
 	const float mYAxisMargin{ 0.06f };
 	const float mYAxisLabelSpacing{ 5.f };
 
+	// paced by the monitor instead of a fixed timer, last so it starts after everything it uses
+	juce::VBlankAttachment mVBlankAttachment{ this, [this] { updateFrame(); } };
+
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MagnitudesComponent)
 };
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+template <int OctaveNumber>
+class OctaveMagnitudesComponent    : public juce::Component, public juce::Timer
+{
+public:
+    OctaveMagnitudesComponent(AudioPluginAudioProcessor& p):
+	processorRef (p)
+    {
+		for (int octave = 0; octave < OctaveNumber; octave++)
+		{
+			mOctaveMagnitudes[octave] = 0.;
+			mOctaveMagnitudesDb[octave] = -80.;
+		}
+		startTimer(15);
+    }
+
+    void paint (juce::Graphics& g) override
+    {
+		auto bounds = getLocalBounds().toFloat();
+		auto circleArea = bounds.withTrimmedBottom(0.08f * bounds.getHeight());
+		auto labelArea = bounds.withTrimmedTop(0.92f * bounds.getHeight());
+
+		g.setFont(14.f / static_cast<float>(PLUGIN_HEIGHT) * getParentHeight());
+		g.setColour(juce::Colours::white);
+		g.drawText("Octave Magnitudes", labelArea, juce::Justification::centred);
+
+		// main empty black circle
+		const float r = 0.5f * std::min(circleArea.getWidth(), circleArea.getHeight());
+		const auto centre = circleArea.getCentre();
+		g.setColour(juce::Colours::black);
+		g.fillEllipse(juce::Rectangle<float>(2.f * r, 2.f * r).withCentre(centre));
+
+		// segment for each octave from low to high, cut values at 0.
+		const float arcAngleIncr = juce::MathConstants<float>::twoPi / static_cast<float>(OctaveNumber);
+		const float colorFadeIncr = 1.f / static_cast<float>(OctaveNumber);
+		float angle = 0.f;
+		for (int o = 0; o < OctaveNumber; o++)
+		{
+			const float rMapping = 1.f / 80.f * (static_cast<float>(mOctaveMagnitudesDb[OctaveNumber - o - 1]) + 80.f);
+			const float octaveR = std::max(0.f, rMapping) * r;
+			juce::Path segment;
+			segment.addPieSegment(juce::Rectangle<float>(2.f * octaveR, 2.f * octaveR).withCentre(centre), angle, angle + arcAngleIncr, 0.f);
+			g.setColour(juce::Colour::fromHSL(static_cast<float>(o) * colorFadeIncr, 0.7f, 0.3f, 1.f));
+			g.fillPath(segment);
+			angle += arcAngleIncr;
+		}
+
+		// octave strings
+		g.setColour(juce::Colours::white);
+		g.setFont(0.1f * r);
+		const float rText = 0.7f * r;
+		const float textSize = 0.3f * r;
+		angle = 0.5f * arcAngleIncr;
+		for (int o = 0; o < OctaveNumber; o++)
+		{
+			const juce::Point<float> textCentre{ centre.x + rText * std::sin(angle), centre.y - rText * std::cos(angle) };
+			g.drawText("A" + juce::String(o), juce::Rectangle<float>(textSize, textSize).withCentre(textCentre), juce::Justification::centred);
+			angle += arcAngleIncr;
+		}
+
+		// separation line
+		g.drawLine(centre.x, centre.y, centre.x, centre.y - r, 3.f);
+		g.fillEllipse(juce::Rectangle<float>(3.f, 3.f).withCentre(centre));
+    }
+
+	void timerCallback() override
+	{
+		double octaveMagnitudes[OctaveNumber];
+		processorRef.getFeatures().getOctaveMagnitudes(octaveMagnitudes);
+		for (int octave = 0; octave < OctaveNumber; octave++)
+		{
+			mOctaveMagnitudes[octave] = mOctaveMagnitudes[octave] * 0.9 + 0.1 * octaveMagnitudes[octave];
+			mOctaveMagnitudesDb[octave] = juce::Decibels::gainToDecibels(mOctaveMagnitudes[octave], -80.);
+		}
+		repaint();
+	}
+
+private:
+	AudioPluginAudioProcessor& processorRef;
+
+	double mOctaveMagnitudes[OctaveNumber];
+	double mOctaveMagnitudesDb[OctaveNumber];
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OctaveMagnitudesComponent)
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+class PitchReadoutComponent    : public juce::Component, public juce::Timer
+{
+public:
+    PitchReadoutComponent(AudioPluginAudioProcessor& p):
+	processorRef (p)
+    {
+		startTimer(50);
+    }
+
+    void paint (juce::Graphics& g) override
+    {
+		auto bounds = getLocalBounds().toFloat();
+		const auto& main = mEstimates[0];
+
+		// main voice: note and cents
+		auto mainRect = bounds.withTrimmedBottom(0.4f * bounds.getHeight());
+		g.setColour(main.isValid() ? juce::Colours::white : juce::Colours::grey);
+		g.setFont(juce::Font(0.6f * mainRect.getHeight(), juce::Font::bold));
+		juce::String mainText = main.getNoteName();
+		if (main.isValid())
+		{
+			mainText += juce::String::formatted("  %+.0f ct", main.cents);
+		}
+		g.drawText(mainText, mainRect, juce::Justification::centred);
+
+		// confidence bar
+		const float confidence = static_cast<float>(main.confidence);
+		auto barRect = mainRect.removeFromBottom(0.08f * bounds.getHeight()).reduced(0.1f * bounds.getWidth(), 0.f);
+		g.setColour(juce::Colours::darkgrey);
+		g.fillRect(barRect);
+		g.setColour(juce::Colour::fromHSV(0.57f, 0.98f, 0.725f, 1.f));
+		g.fillRect(barRect.withWidth(confidence * barRect.getWidth()));
+
+		// further voices
+		auto voicesRect = bounds.withTrimmedTop(0.6f * bounds.getHeight());
+		juce::String voicesText;
+		for (int voice = 1; voice < PitchMaxVoices; voice++)
+		{
+			if (mEstimates[voice].isValid())
+				voicesText += juce::String(mEstimates[voice].getNoteName()) + "  ";
+		}
+		g.setColour(juce::Colours::white);
+		g.setFont(juce::Font(0.6f * voicesRect.getHeight()));
+		g.drawText(voicesText.trim(), voicesRect, juce::Justification::centred);
+    }
+
+	void timerCallback() override
+	{
+		mEstimates = processorRef.getPitchEstimates();
+		repaint();
+	}
+
+private:
+	AudioPluginAudioProcessor& processorRef;
+
+	std::array<PitchEstimate, PitchMaxVoices> mEstimates;
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PitchReadoutComponent)
+};
@@ -0,0 +1,99 @@
+// Interceptors for RealtimeChecks. Link this file into an executable, not into the plugin, so its
+// definitions take precedence over the C library's for the whole process.
+// libstdc++'s operator new/delete and std::mutex end up in malloc, free and pthread_mutex_lock, which
+// covers them without replacing them separately. glibc only, elsewhere this compiles to nothing.
+// ThreadSanitizer intercepts the same functions and crashes with a second interposer, so sanitized
+// builds compile to nothing as well.
+
+#include "../include/RealtimeChecks.h"
+
+#if defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+#define CQT_THREAD_SANITIZER 1
+#endif
+#endif
+#if defined(__SANITIZE_THREAD__)
+#define CQT_THREAD_SANITIZER 1
+#endif
+
+#if CQT_REALTIME_CHECKS && defined(__linux__) && defined(__GLIBC__) && !defined(CQT_THREAD_SANITIZER)
+
+#include <dlfcn.h>
+#include <pthread.h>
+
+extern "C"
+{
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* pointer, size_t size);
+    void* __libc_memalign(size_t alignment, size_t size);
+    void __libc_free(void* pointer);
+
+    void* malloc(size_t size)
+    {
+        RealtimeChecks::check(kRealtimeAllocation);
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size)
+    {
+        RealtimeChecks::check(kRealtimeAllocation);
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* pointer, size_t size)
+    {
+        RealtimeChecks::check(kRealtimeAllocation);
+        return __libc_realloc(pointer, size);
+    }
+
+    void* aligned_alloc(size_t alignment, size_t size)
+    {
+        RealtimeChecks::check(kRealtimeAllocation);
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void** pointer, size_t alignment, size_t size)
+    {
+        RealtimeChecks::check(kRealtimeAllocation);
+        *pointer = __libc_memalign(alignment, size);
+        return *pointer != nullptr ? 0 : 12; // ENOMEM
+    }
+
+    // freeing takes the allocator's locks as well
+    void free(void* pointer)
+    {
+        if (pointer != nullptr)
+            RealtimeChecks::check(kRealtimeAllocation);
+        __libc_free(pointer);
+    }
+
+    int pthread_mutex_lock(pthread_mutex_t* mutex)
+    {
+        using MutexLock = int (*)(pthread_mutex_t*);
+        static std::atomic<MutexLock> realMutexLock{ nullptr };
+        MutexLock real = realMutexLock.load(std::memory_order_relaxed);
+        if (real == nullptr)
+        {
+            real = reinterpret_cast<MutexLock>(::dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+            realMutexLock.store(real, std::memory_order_relaxed);
+        }
+        RealtimeChecks::check(kRealtimeLock);
+        return real(mutex);
+    }
+}
+
+namespace
+{
+    // backtrace() loads the unwinder on first use, do that before any thread is marked
+    struct PrimeBacktrace
+    {
+        PrimeBacktrace()
+        {
+            void* frames[1];
+            ::backtrace(frames, 1);
+        }
+    } primeBacktrace;
+}
+
+#endif
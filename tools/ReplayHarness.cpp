@@ -0,0 +1,347 @@
+// Headless record/replay harness for the CqtAnalyzer processor.
+// Feeds a WAV file through prepareToPlay/processBlock with the processor's virtual clock, so octave
+// transforms are scheduled by the number of processed samples instead of timer wakeups and two runs
+// on the same input produce identical frames.
+// In builds with CQT_REALTIME_CHECKS any allocation or lock inside processBlock fails the run.
+//
+// Usage: ReplayHarness <input.wav> [--block N] [--record golden.bin] [--compare golden.bin] [--tolerance dB]
+//                      [--export features.npy] [--grid-rate Hz] [--interpolation linear|cubic]
+//
+// Golden file layout (little endian): "CQTG", uint32 version, uint32 binsPerOctave, uint32 octaveNumber,
+// uint64 frameCount, then per frame uint32 octave, uint64 samplePosition and binsPerOctave doubles.
+//
+// --export resamples all octaves onto a uniform grid (see GridResampler) and writes a dense
+// rows x (octaveNumber * binsPerOctave) float32 matrix, lowest bin first, row k centred on input sample
+// k * sampleRate / gridRate. A .npy path gets a NumPy header, anything else the matrix layout:
+// "CQTM", uint32 version, uint32 columns, uint32 binsPerOctave, double gridRate, uint64 rows.
+// Either header is padded so the data starts 64 byte aligned for mapping.
+
+#include "../CqtAnalyzer/PluginProcessor.h"
+#include "../include/GridResampler.h"
+
+#include <juce_audio_formats/juce_audio_formats.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    constexpr uint32_t GoldenVersion{ 1 };
+    constexpr uint32_t MatrixVersion{ 1 };
+    constexpr size_t MatrixHeaderSize{ 64 };
+
+    struct CapturedFrame
+    {
+        uint32_t octave;
+        uint64_t samplePosition;
+        double magnitudes[BinsPerOctave];
+    };
+
+    bool writeGolden(const std::string& path, const std::vector<CapturedFrame>& frames)
+    {
+        std::ofstream out(path, std::ios::binary);
+        if (!out)
+            return false;
+        const uint32_t bins = BinsPerOctave;
+        const uint32_t octaves = OctaveNumber;
+        const uint64_t count = frames.size();
+        out.write("CQTG", 4);
+        out.write(reinterpret_cast<const char*>(&GoldenVersion), sizeof(GoldenVersion));
+        out.write(reinterpret_cast<const char*>(&bins), sizeof(bins));
+        out.write(reinterpret_cast<const char*>(&octaves), sizeof(octaves));
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        for (const auto& frame : frames)
+        {
+            out.write(reinterpret_cast<const char*>(&frame.octave), sizeof(frame.octave));
+            out.write(reinterpret_cast<const char*>(&frame.samplePosition), sizeof(frame.samplePosition));
+            out.write(reinterpret_cast<const char*>(frame.magnitudes), sizeof(frame.magnitudes));
+        }
+        return static_cast<bool>(out);
+    }
+
+    bool readGolden(const std::string& path, std::vector<CapturedFrame>& frames)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            return false;
+        char magic[4];
+        uint32_t version = 0, bins = 0, octaves = 0;
+        uint64_t count = 0;
+        in.read(magic, 4);
+        in.read(reinterpret_cast<char*>(&version), sizeof(version));
+        in.read(reinterpret_cast<char*>(&bins), sizeof(bins));
+        in.read(reinterpret_cast<char*>(&octaves), sizeof(octaves));
+        in.read(reinterpret_cast<char*>(&count), sizeof(count));
+        if (!in || std::string(magic, 4) != "CQTG" || version != GoldenVersion
+            || bins != BinsPerOctave || octaves != OctaveNumber)
+            return false;
+        frames.resize(count);
+        for (auto& frame : frames)
+        {
+            in.read(reinterpret_cast<char*>(&frame.octave), sizeof(frame.octave));
+            in.read(reinterpret_cast<char*>(&frame.samplePosition), sizeof(frame.samplePosition));
+            in.read(reinterpret_cast<char*>(frame.magnitudes), sizeof(frame.magnitudes));
+        }
+        return static_cast<bool>(in);
+    }
+
+    // streams rows into a .npy or matrix file, the row count is patched in on close
+    class MatrixWriter
+    {
+    public:
+        bool open(const std::string& path, const uint32_t columns, const double gridRate)
+        {
+            mColumns = columns;
+            mGridRate = gridRate;
+            mNumpy = path.size() >= 4 && path.compare(path.size() - 4, 4, ".npy") == 0;
+            mOut.open(path, std::ios::binary | std::ios::trunc);
+            return mOut && writeHeader(0);
+        }
+
+        void writeRow(const float* values)
+        {
+            mOut.write(reinterpret_cast<const char*>(values), static_cast<std::streamsize>(mColumns * sizeof(float)));
+            mRows++;
+        }
+
+        bool close()
+        {
+            mOut.seekp(0);
+            const bool written = writeHeader(mRows);
+            mOut.close();
+            return written && static_cast<bool>(mOut);
+        }
+
+        uint64_t getRows() const
+        {
+            return mRows;
+        }
+
+    private:
+        bool writeHeader(const uint64_t rows)
+        {
+            std::string header;
+            if (mNumpy)
+            {
+                // the shape is padded to a fixed width, so the final row count fits in place
+                char dict[128];
+                std::snprintf(dict, sizeof(dict), "{'descr': '<f4', 'fortran_order': False, 'shape': (%20llu, %u), }",
+                    static_cast<unsigned long long>(rows), mColumns);
+                const size_t dictSize = std::strlen(dict);
+                const size_t paddedSize = (10 + dictSize + 1 + MatrixHeaderSize - 1) / MatrixHeaderSize * MatrixHeaderSize;
+                const uint16_t headerLength = static_cast<uint16_t>(paddedSize - 10);
+                header.append("\x93NUMPY\x01\x00", 8);
+                header.append(reinterpret_cast<const char*>(&headerLength), sizeof(headerLength));
+                header.append(dict);
+                header.append(paddedSize - header.size() - 1, ' ');
+                header.push_back('\n');
+            }
+            else
+            {
+                const uint32_t bins = BinsPerOctave;
+                header.append("CQTM", 4);
+                header.append(reinterpret_cast<const char*>(&MatrixVersion), sizeof(MatrixVersion));
+                header.append(reinterpret_cast<const char*>(&mColumns), sizeof(mColumns));
+                header.append(reinterpret_cast<const char*>(&bins), sizeof(bins));
+                header.append(reinterpret_cast<const char*>(&mGridRate), sizeof(mGridRate));
+                header.append(reinterpret_cast<const char*>(&rows), sizeof(rows));
+                header.resize(MatrixHeaderSize, '\0');
+            }
+            mOut.write(header.data(), static_cast<std::streamsize>(header.size()));
+            return static_cast<bool>(mOut);
+        }
+
+        std::ofstream mOut;
+        uint32_t mColumns{ 0 };
+        double mGridRate{ 0. };
+        bool mNumpy{ false };
+        uint64_t mRows{ 0 };
+    };
+
+    double toDb(const double magnitude)
+    {
+        return 20. * std::log10(std::max(magnitude, 1e-6));
+    }
+
+    // returns the number of mismatching frames, -1 if the frame sequences differ structurally
+    int64_t compareFrames(const std::vector<CapturedFrame>& frames, const std::vector<CapturedFrame>& golden, const double toleranceDb, double& maxDeviationDb)
+    {
+        maxDeviationDb = 0.;
+        if (frames.size() != golden.size())
+            return -1;
+        int64_t mismatches = 0;
+        for (size_t i = 0; i < frames.size(); i++)
+        {
+            if (frames[i].octave != golden[i].octave || frames[i].samplePosition != golden[i].samplePosition)
+                return -1;
+            double deviation = 0.;
+            for (int tone = 0; tone < BinsPerOctave; tone++)
+            {
+                deviation = std::max(deviation, std::abs(toDb(frames[i].magnitudes[tone]) - toDb(golden[i].magnitudes[tone])));
+            }
+            maxDeviationDb = std::max(maxDeviationDb, deviation);
+            if (deviation > toleranceDb)
+                mismatches++;
+        }
+        return mismatches;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <input.wav> [--block N] [--record golden.bin] [--compare golden.bin] [--tolerance dB]"
+            << " [--export features.npy] [--grid-rate Hz] [--interpolation linear|cubic]" << std::endl;
+        return 1;
+    }
+    const juce::File inputFile = juce::File::getCurrentWorkingDirectory().getChildFile(argv[1]);
+    int blockSize = 64;
+    std::string recordPath;
+    std::string comparePath;
+    double toleranceDb = 0.01;
+    std::string exportPath;
+    double gridRate = 100.;
+    GridInterpolation interpolation = GridInterpolation::Linear;
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        const std::string option = argv[i];
+        if (option == "--block")
+            blockSize = std::max(1, std::atoi(argv[i + 1]));
+        else if (option == "--record")
+            recordPath = argv[i + 1];
+        else if (option == "--compare")
+            comparePath = argv[i + 1];
+        else if (option == "--tolerance")
+            toleranceDb = std::atof(argv[i + 1]);
+        else if (option == "--export")
+            exportPath = argv[i + 1];
+        else if (option == "--grid-rate")
+            gridRate = std::max(1e-3, std::atof(argv[i + 1]));
+        else if (option == "--interpolation")
+            interpolation = std::string(argv[i + 1]) == "cubic" ? GridInterpolation::Cubic : GridInterpolation::Linear;
+    }
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(inputFile));
+    if (reader == nullptr)
+    {
+        std::cerr << "cannot read " << inputFile.getFullPathName() << std::endl;
+        return 1;
+    }
+    const double sampleRate = reader->sampleRate;
+    const auto numSamples = static_cast<int64_t>(reader->lengthInSamples);
+
+    AudioPluginAudioProcessor processor;
+    processor.setVirtualClock(true);
+    processor.setPlayConfigDetails(2, 2, sampleRate, blockSize);
+
+    std::vector<CapturedFrame> frames;
+    GridResampler<BinsPerOctave, OctaveNumber> resampler;
+    MatrixWriter matrixWriter;
+    const bool exporting = !exportPath.empty();
+    processor.setFrameListener([&](const int octave, const uint64_t samplePosition, const double* magnitudes)
+    {
+        CapturedFrame frame;
+        frame.octave = static_cast<uint32_t>(octave);
+        frame.samplePosition = samplePosition;
+        std::copy(magnitudes, magnitudes + BinsPerOctave, frame.magnitudes);
+        frames.push_back(frame);
+        if (exporting)
+        {
+            const uint64_t centreOffset = processor.getEngine().getWindowCentreOffset(octave);
+            resampler.push(octave, samplePosition - std::min(samplePosition, centreOffset), magnitudes);
+        }
+    });
+    processor.prepareToPlay(sampleRate, blockSize);
+
+    if (exporting)
+    {
+        if (!matrixWriter.open(exportPath, GridResampler<BinsPerOctave, OctaveNumber>::NumColumns, gridRate))
+        {
+            std::cerr << "cannot write " << exportPath << std::endl;
+            return 1;
+        }
+        bool activeOctaves[OctaveNumber];
+        for (int o = 0; o < OctaveNumber; o++)
+        {
+            activeOctaves[o] = processor.isOctaveActive(o);
+        }
+        resampler.prepare(sampleRate, gridRate, interpolation, activeOctaves,
+            [&matrixWriter](const uint64_t, const float* values) { matrixWriter.writeRow(values); });
+    }
+
+    juce::AudioBuffer<float> buffer(2, blockSize);
+    juce::MidiBuffer midi;
+    const auto start = std::chrono::steady_clock::now();
+    for (int64_t position = 0; position < numSamples; position += blockSize)
+    {
+        const int numBlockSamples = static_cast<int>(std::min<int64_t>(blockSize, numSamples - position));
+        buffer.setSize(2, numBlockSamples, false, false, true);
+        reader->read(&buffer, 0, numBlockSamples, position, true, true);
+        processor.processBlock(buffer, midi);
+        processor.advanceVirtualClock();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    processor.releaseResources();
+
+    if (exporting)
+    {
+        resampler.finish();
+        if (!matrixWriter.close())
+        {
+            std::cerr << "cannot write " << exportPath << std::endl;
+            return 1;
+        }
+        std::printf("exported %llu rows at %.2f Hz to %s\n", static_cast<unsigned long long>(matrixWriter.getRows()),
+            gridRate, exportPath.c_str());
+    }
+
+    std::printf("%lld samples, %zu frames in %.3f s: %.0f samples/s (%.1fx real time)\n",
+        static_cast<long long>(numSamples), frames.size(), seconds,
+        static_cast<double>(numSamples) / seconds, static_cast<double>(numSamples) / sampleRate / seconds);
+
+    if (RealtimeChecks::getNumViolations() > 0)
+    {
+        std::printf("FAIL: processBlock is not real-time safe\n");
+        RealtimeChecks::printReport(stdout);
+        return 3;
+    }
+
+    if (!recordPath.empty())
+    {
+        if (!writeGolden(recordPath, frames))
+        {
+            std::cerr << "cannot write " << recordPath << std::endl;
+            return 1;
+        }
+        std::printf("recorded %s\n", recordPath.c_str());
+    }
+
+    if (!comparePath.empty())
+    {
+        std::vector<CapturedFrame> golden;
+        if (!readGolden(comparePath, golden))
+        {
+            std::cerr << "cannot read golden file " << comparePath << std::endl;
+            return 1;
+        }
+        double maxDeviationDb = 0.;
+        const int64_t mismatches = compareFrames(frames, golden, toleranceDb, maxDeviationDb);
+        if (mismatches < 0)
+        {
+            std::printf("FAIL: frame sequence differs from %s (%zu vs %zu frames)\n", comparePath.c_str(), frames.size(), golden.size());
+            return 2;
+        }
+        std::printf("%s: %lld of %zu frames outside %.4f dB, max deviation %.6f dB\n",
+            mismatches == 0 ? "PASS" : "FAIL", static_cast<long long>(mismatches), frames.size(), toleranceDb, maxDeviationDb);
+        return mismatches == 0 ? 0 : 2;
+    }
+    return 0;
+}
@@ -0,0 +1,178 @@
+// Reference reader for the shared-memory frame ring published by the CqtAnalyzer processor.
+// Usage: ShmFrameReader <name> [numFrames]
+// Prints one line per frame: frame index, octave, sample position, window centre, loudest bin and its level,
+// the measured frequency of that bin, the strength of an onset event, key and chord indices, or the
+// strongest chroma and octave.
+
+#include "../include/SharedMemoryPublisher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::fprintf(stderr, "usage: %s <name> [numFrames]\n", argv[0]);
+        return 1;
+    }
+    const uint64_t numFrames = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 0;
+
+    // read-write only for the reader heartbeat, which keeps the writer's analysis running
+    const int fd = ::shm_open(argv[1], O_RDWR, 0);
+    if (fd < 0)
+    {
+        std::perror("shm_open");
+        return 1;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SharedFrameHeader))
+    {
+        std::fprintf(stderr, "region too small\n");
+        ::close(fd);
+        return 1;
+    }
+    const size_t regionBytes = static_cast<size_t>(st.st_size);
+    void* mapped = ::mmap(nullptr, regionBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        std::perror("mmap");
+        return 1;
+    }
+    const auto* region = static_cast<const uint8_t*>(mapped);
+    auto* header = reinterpret_cast<SharedFrameHeader*>(static_cast<uint8_t*>(mapped));
+
+    if (header->magic != SharedFrameMagic || header->version != SharedFrameVersion)
+    {
+        std::fprintf(stderr, "unsupported layout (magic %08x, version %u)\n", header->magic, header->version);
+        return 1;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint32_t bins = header->binsPerOctave;
+    const uint32_t numSlots = header->numSlots;
+    const uint32_t slotBytes = header->slotBytes;
+    if (sizeof(SharedFrameHeader) + static_cast<size_t>(numSlots) * slotBytes > regionBytes)
+    {
+        std::fprintf(stderr, "inconsistent header\n");
+        return 1;
+    }
+    std::printf("bins/octave %u, octaves %u, slots %u, sample rate %.1f\n",
+        bins, header->octaveNumber, numSlots, header->sampleRate);
+
+    std::vector<double> magnitudes(bins);
+    std::vector<uint32_t> peakBins(header->octaveNumber, 0);
+    uint64_t next = header->writeIndex.load(std::memory_order_acquire);
+    uint64_t printed = 0;
+    uint64_t dropped = 0;
+    while (numFrames == 0 || printed < numFrames)
+    {
+        const auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch());
+        header->readerHeartbeat.store(static_cast<uint64_t>(now.count()), std::memory_order_relaxed);
+        const uint64_t written = header->writeIndex.load(std::memory_order_acquire);
+        if (next == written)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        if (written - next > numSlots)
+        {
+            // lapped by the writer, skip to the oldest frame still in the ring
+            dropped += written - next - numSlots;
+            next = written - numSlots;
+        }
+
+        const auto* slot = reinterpret_cast<const SharedFrameSlot*>(region + sizeof(SharedFrameHeader) + (next % numSlots) * slotBytes);
+        const uint64_t expected = 2 * (next / numSlots) + 2;
+        const uint64_t sequenceBefore = slot->sequence.load(std::memory_order_acquire);
+        if (sequenceBefore < expected)
+        {
+            // claimed but not completed yet
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            continue;
+        }
+        const uint64_t frameIndex = slot->frameIndex;
+        const uint64_t samplePosition = slot->samplePosition;
+        const uint64_t centrePosition = slot->centrePosition;
+        const uint32_t octave = slot->octave;
+        const uint32_t type = slot->type;
+        std::memcpy(magnitudes.data(), reinterpret_cast<const uint8_t*>(slot) + sizeof(SharedFrameSlot), bins * sizeof(double));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t sequenceAfter = slot->sequence.load(std::memory_order_relaxed);
+        next++;
+        if (sequenceBefore != expected || sequenceAfter != expected)
+        {
+            dropped++;
+            continue;
+        }
+
+        if (type == kSharedFrameOnset)
+        {
+            std::printf("%10llu octave %2u at %12llu onset strength %.2f dB (dropped %llu)\n",
+                static_cast<unsigned long long>(frameIndex), octave, static_cast<unsigned long long>(centrePosition),
+                magnitudes[0], static_cast<unsigned long long>(dropped));
+            printed++;
+            continue;
+        }
+
+        if (type == kSharedFrameKeyChord)
+        {
+            std::printf("%10llu key %2d chord %2d pos %12llu confidence %.2f / %.2f (dropped %llu)\n",
+                static_cast<unsigned long long>(frameIndex), static_cast<int>(magnitudes[0]), static_cast<int>(magnitudes[1]),
+                static_cast<unsigned long long>(samplePosition), magnitudes[2], magnitudes[3], static_cast<unsigned long long>(dropped));
+            printed++;
+            continue;
+        }
+
+        if (type == kSharedFrameChroma || type == kSharedFrameOctaveMagnitudes)
+        {
+            const uint32_t numValues = std::min(type == kSharedFrameChroma ? 12u : header->octaveNumber, bins);
+            uint32_t strongest = 0;
+            for (uint32_t v = 1; v < numValues; v++)
+            {
+                if (magnitudes[v] > magnitudes[strongest])
+                    strongest = v;
+            }
+            std::printf("%10llu %-6s %2u pos %12llu value %.3f (dropped %llu)\n",
+                static_cast<unsigned long long>(frameIndex), type == kSharedFrameChroma ? "chroma" : "octave", strongest,
+                static_cast<unsigned long long>(samplePosition), magnitudes[strongest], static_cast<unsigned long long>(dropped));
+            printed++;
+            continue;
+        }
+
+        if (type == kSharedFrameFrequencies)
+        {
+            // follows the octave's magnitude frame
+            const uint32_t peakBin = octave < peakBins.size() ? peakBins[octave] : 0;
+            std::printf("%10llu octave %2u pos %12llu peak bin %3u %10.3f Hz (dropped %llu)\n",
+                static_cast<unsigned long long>(frameIndex), octave, static_cast<unsigned long long>(samplePosition),
+                peakBin, magnitudes[peakBin], static_cast<unsigned long long>(dropped));
+            printed++;
+            continue;
+        }
+
+        uint32_t peakBin = 0;
+        for (uint32_t b = 1; b < bins; b++)
+        {
+            if (magnitudes[b] > magnitudes[peakBin])
+                peakBin = b;
+        }
+        if (octave < peakBins.size())
+            peakBins[octave] = peakBin;
+        const double peakDb = 20. * std::log10(magnitudes[peakBin] + 1e-12);
+        std::printf("%10llu octave %2u pos %12llu centre %12llu peak bin %3u %7.1f dB (dropped %llu)\n",
+            static_cast<unsigned long long>(frameIndex), octave, static_cast<unsigned long long>(samplePosition),
+            static_cast<unsigned long long>(centrePosition), peakBin, peakDb, static_cast<unsigned long long>(dropped));
+        printed++;
+    }
+
+    ::munmap(mapped, regionBytes);
+    return 0;
+}
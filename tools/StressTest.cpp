@@ -0,0 +1,169 @@
+// Concurrency stress test for the CqtAnalyzer processor.
+// Drives all threads that share processor state at once: an audio thread calling processBlock with
+// random block sizes, the octave timer threads, a message thread retuning every few milliseconds and
+// reading everything the editor reads, and a host thread re-running prepareToPlay. Build with
+// -DCQT_ENABLE_TSAN=ON to have ThreadSanitizer report data races.
+// The processBlock latency distribution is printed to show the cost of contention. In builds with
+// CQT_REALTIME_CHECKS any allocation or lock inside processBlock fails the run.
+//
+// Usage: StressTest [seconds] [seed]
+
+#include "../CqtAnalyzer/PluginProcessor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+
+namespace
+{
+    constexpr double StressSampleRate{ 48000. };
+    constexpr int StressMaxBlockSize{ 1024 };
+    // input is fed this many times faster than real time, more blocks per octave call mean more contention
+    constexpr double StressSpeedup{ 4. };
+
+    using Clock = std::chrono::steady_clock;
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    const double durationSeconds = argc > 1 ? std::atof(argv[1]) : 10.;
+    const unsigned seed = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 1u;
+
+    AudioPluginAudioProcessor processor;
+    // stands in for the editor, whose reads the message thread below mimics
+    processor.addConsumer();
+    processor.setPlayConfigDetails(2, 2, StressSampleRate, StressMaxBlockSize);
+    processor.prepareToPlay(StressSampleRate, StressMaxBlockSize);
+
+    std::atomic<bool> running{ true };
+    // hosts never call prepareToPlay concurrently with processBlock, the audio thread parks meanwhile
+    std::mutex hostMutex;
+
+    std::vector<double> blockMicros;
+    blockMicros.reserve(1 << 20);
+    std::atomic<uint64_t> numPrepares{ 0 };
+    std::atomic<uint64_t> numRetunes{ 0 };
+    std::atomic<uint64_t> numReads{ 0 };
+
+    std::thread audioThread([&]
+    {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int> blockSizes(1, StressMaxBlockSize);
+        std::uniform_real_distribution<float> noise(-1.f, 1.f);
+        juce::AudioBuffer<float> buffer(2, StressMaxBlockSize);
+        juce::MidiBuffer midi;
+        while (running.load())
+        {
+            const int blockSize = blockSizes(rng);
+            buffer.setSize(2, blockSize, false, false, true);
+            for (int c = 0; c < 2; c++)
+            {
+                for (int s = 0; s < blockSize; s++)
+                {
+                    buffer.setSample(c, s, 0.5f * noise(rng));
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(hostMutex);
+                const auto start = Clock::now();
+                processor.processBlock(buffer, midi);
+                blockMicros.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+            }
+            // paced at StressSpeedup times real time, sleeping only the block's share of it
+            std::this_thread::sleep_for(std::chrono::microseconds(static_cast<int64_t>(1e6 * blockSize / StressSampleRate / StressSpeedup)));
+        }
+    });
+
+    std::thread messageThread([&]
+    {
+        std::mt19937 rng(seed + 1);
+        std::uniform_real_distribution<double> tunings(415.305, 466.164);
+        std::uniform_int_distribution<int> channels(0, 3);
+        double frame[OctaveNumber][BinsPerOctave];
+        double sink = 0.;
+        while (running.load())
+        {
+            processor.setTuning(tunings(rng));
+            processor.setChannel(channels(rng));
+            numRetunes++;
+
+            // everything the editor timers read
+            processor.getEngine().readMagnitudes(frame);
+            processor.getEngine().readInstantaneousFreqs(frame);
+            for (int o = 0; o < OctaveNumber; o++)
+            {
+                for (int tone = 0; tone < BinsPerOctave; tone++)
+                {
+                    sink += frame[o][tone];
+                }
+            }
+            if (processor.getEngine().mNewKernelFreqs)
+            {
+                sink += processor.getEngine().mKernelFreqs[0][0];
+                processor.getEngine().mNewKernelFreqs = false;
+            }
+            double chroma[ChromaBins];
+            double octaveMagnitudes[OctaveNumber];
+            processor.getFeatures().getChroma(chroma);
+            processor.getFeatures().getOctaveMagnitudes(octaveMagnitudes);
+            sink += chroma[0] + octaveMagnitudes[0];
+            sink += processor.getPitchEstimates()[0].frequency;
+            sink += processor.getKeyChord().keyConfidence;
+            OnsetEvent onset;
+            const auto& onsets = processor.getOnsets();
+            if (onsets.getNumEvents() > 0 && onsets.getEvent(onsets.getNumEvents() - 1, onset))
+                sink += onset.strength;
+            if (processor.readHistory(0.5, 0, frame))
+                sink += frame[0][0];
+            numReads++;
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(3));
+        }
+        juce::ignoreUnused(sink);
+    });
+
+    std::thread hostThread([&]
+    {
+        std::mt19937 rng(seed + 2);
+        std::uniform_int_distribution<int> pauses(5, 50);
+        while (running.load())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(pauses(rng)));
+            std::lock_guard<std::mutex> lock(hostMutex);
+            processor.prepareToPlay(StressSampleRate, StressMaxBlockSize);
+            numPrepares++;
+        }
+    });
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(durationSeconds));
+    running.store(false);
+    audioThread.join();
+    messageThread.join();
+    hostThread.join();
+    processor.releaseResources();
+
+    std::sort(blockMicros.begin(), blockMicros.end());
+    const auto percentile = [&blockMicros](const double p)
+    {
+        if (blockMicros.empty())
+            return 0.;
+        return blockMicros[std::min(blockMicros.size() - 1, static_cast<size_t>(p * static_cast<double>(blockMicros.size())))];
+    };
+    std::printf("%zu blocks, %llu prepares, %llu retunes, %llu editor reads\n", blockMicros.size(),
+        static_cast<unsigned long long>(numPrepares.load()), static_cast<unsigned long long>(numRetunes.load()),
+        static_cast<unsigned long long>(numReads.load()));
+    std::printf("processBlock latency [us]: median %.1f, p99 %.1f, p99.9 %.1f, max %.1f\n",
+        percentile(0.5), percentile(0.99), percentile(0.999), blockMicros.empty() ? 0. : blockMicros.back());
+
+    if (RealtimeChecks::getNumViolations() > 0)
+    {
+        std::printf("FAIL: processBlock is not real-time safe\n");
+        RealtimeChecks::printReport(stdout);
+        return 3;
+    }
+    return 0;
+}